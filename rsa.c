@@ -2,13 +2,137 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 
 /*
  * RSA avec rduction par division euclidienne
- * Oprations en mode octet.
- * Un mot est un octet uint8_t, un mot double est un uint16_t
+ * Oprations en mode mot, la taille du mot est fixe  la compilation
+ * par LIMB_BITS (8 par dfaut, 16, 32 ou 64 avec -DLIMB_BITS=64).
+ * En mode octet, un mot est un uint8_t et un mot double un uint16_t ;
+ * en mode 64 bits, un mot est un uint64_t et un mot double un
+ * unsigned __int128. Le type sign smot contient au moins LIMB_BITS+2
+ * bits (cofacteurs de l'algorithme de Lehmer).
  */
+#ifndef LIMB_BITS
+#define LIMB_BITS 8
+#endif
+
+#if LIMB_BITS==8
+typedef uint8_t  mot;
+typedef uint16_t dmot;
+typedef int32_t  smot;
+#elif LIMB_BITS==16
+typedef uint16_t mot;
+typedef uint32_t dmot;
+typedef int32_t  smot;
+#elif LIMB_BITS==32
+typedef uint32_t mot;
+typedef uint64_t dmot;
+typedef int64_t  smot;
+#elif LIMB_BITS==64
+typedef uint64_t mot;
+typedef unsigned __int128 dmot;
+typedef __int128 smot;
+#else
+#error "LIMB_BITS doit valoir 8, 16, 32 ou 64"
+#endif
+
+#define MOT_OCTETS (LIMB_BITS/8)   // nombre d'octets par mot
+#define MOT_MAX    ((mot)-1)       // mot tout  1
+#define MOT_HAUT   ((mot)1<<(LIMB_BITS-1)) // bit de poids fort d'un mot
+
+/////////////////////////////////////////////////////////
+// compteurs d'instrumentation
+// Compils seulement avec -DRSA_COMPTEURS ; sans cette option les macros
+// CPT_xxx sont vides et le code produit est inchang.
+// On compte les appels de SMul_a_a, les tours de la boucle de correction
+// du quotient partiel et les "dernires corrections" de la division,
+// ainsi que les appels et les cycles (rdtsc, ou nanosecondes  dfaut)
+// de LLMul, Modulo (et de la rduction d'un contexte, ModuloCtx) et
+// LLExpMod. Les cycles sont inclusifs : ceux de
+// LLExpMod comprennent ceux des LLMul et Modulo qu'il appelle.
+// Les compteurs sont globaux, donc approximatifs en multi-thread.
+/////////////////////////////////////////////////////////
+#ifdef RSA_COMPTEURS
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CPT_UNITE "cycles"
+static inline uint64_t cpt_horloge(void)
+{
+    return __rdtsc();
+}
+#else
+#define CPT_UNITE "ns"
+static inline uint64_t cpt_horloge(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (uint64_t)ts.tv_sec*1000000000u+ts.tv_nsec;
+}
+#endif
+
+// appels et cycles d'une opration
+typedef struct
+{
+    uint64_t appels;
+    uint64_t cycles;
+} cpt_op;
+
+struct
+{
+    uint64_t smul;          // appels de SMul_a_a
+    uint64_t correction;    // tours de boucle de correction du quotient
+    uint64_t rajout;        // dernires corrections (rajout du diviseur)
+    cpt_op   llmul;
+    cpt_op   modulo;
+    cpt_op   llexpmod;
+} compteurs;
+
+#define CPT_INC(ev)     (compteurs.ev++)
+#define CPT_AJOUTE(ev,n) (compteurs.ev+=(n))
+#define CPT_DEBUT(op)   uint64_t cpt_t0_##op=cpt_horloge()
+#define CPT_FIN(op)     (compteurs.op.appels++, \
+                         compteurs.op.cycles+=cpt_horloge()-cpt_t0_##op)
+
+static void cpt_ligne(const char*nom, cpt_op*o)
+{
+    printf("%-10s %12" PRIu64 " %16" PRIu64 " %12.0f\n",nom,o->appels,o->cycles,
+           o->appels ? (double)o->cycles/o->appels : 0.0);
+}
+
+// rapport des compteurs
+void CompteursAffiche(void)
+{
+    printf("%-10s %12s %16s %12s\n","operation","appels",CPT_UNITE,"par appel");
+    cpt_ligne("LLMul",&compteurs.llmul);
+    cpt_ligne("Modulo",&compteurs.modulo);
+    cpt_ligne("LLExpMod",&compteurs.llexpmod);
+    printf("SMul_a_a   %12" PRIu64 "\n",compteurs.smul);
+    printf("correction %12" PRIu64 "  (boucle d'ajustement du quotient partiel)\n",
+           compteurs.correction);
+    printf("rajout     %12" PRIu64 "  (dernire correction de la division)\n",
+           compteurs.rajout);
+}
+
+// remise  zro des compteurs
+void CompteursRaz(void)
+{
+    memset(&compteurs,0,sizeof(compteurs));
+}
+#else
+#define CPT_INC(ev)     ((void)0)
+#define CPT_AJOUTE(ev,n) ((void)0)
+#define CPT_DEBUT(op)
+#define CPT_FIN(op)     ((void)0)
+#endif
 
 // multiplication courte avec deux accumulations a x b + c + carry
 // le rsultat intermdiaire est un mot double
@@ -17,39 +141,51 @@
 // a x b + c + carry < 2^2n -2.2^n + 1 + 2^n - 1 + 2^n - 1 = 2^2n - 1
 // il n'y a donc pas de dbordement sur des mots doubles
 //////////////////////////////////////////////////////////////////
-uint8_t SMul_a_a(uint8_t a, uint8_t b, uint8_t c, uint8_t*carry)
+mot SMul_a_a(mot a, mot b, mot c, mot*carry)
 {
-	uint16_t p;
-	p=(uint16_t)a*(uint16_t)b+(uint16_t)*carry+(uint16_t)c;
-	*carry=p>>8;
+	dmot p;
+	CPT_INC(smul);
+	p=(dmot)a*(dmot)b+(dmot)*carry+(dmot)c;
+	*carry=p>>LIMB_BITS;
 	return p;
 }
 
-// division courte de (carry, x) par y
-// algorithme binaire
-// le diviseur y doit tre suprieur  carry
+// inverse d'un chiffre normalis d (bit de poids fort  1)
+// rend v = floor((B^2-1)/d) - B, qui tient dans un mot
+// (Mller et Granlund, "Improved division by invariant integers")
+//--------------------
+static mot MotInv(mot d)
+{
+	return (((dmot)(mot)~d<<LIMB_BITS)|MOT_MAX)/d;
+}
+
+// division courte de (carry, x) par y  l'aide de l'inverse v = MotInv(y)
+// le diviseur y doit tre normalis et suprieur  carry
+// deux multiplications et au plus deux corrections au lieu d'une
+// boucle par bit
 // rend le quotient et affecte le reste  *carry
 //--------------------
-static uint8_t SDiv(uint8_t x,uint8_t y,uint8_t*carry)
-{
-	int i;    // index de boucle
-	int8_t c;  // retenue
-	uint8_t r;   // reste local
-
-	r=*carry;   // (r,x)
-	for (i=8;i>0;--i)
-	{   // (c7,r,x) <-- (r,x) * 2 (dcalage)
-		c= r & 0x80; // retenue = 1er chiffre de (r,x)
-		r=(r<<1)+(x>>(8-1));
-		x<<=1;
-		if ( (c!=0) || (r>=y) )
-		{   // test (c7,r,x) >= (y,0)
-			++x;  // le chiffre du quotient est insr  droite de x
-			r-=y;
-		}
+static mot SDivInv(mot x,mot y,mot v,mot*carry)
+{
+	dmot q;   // estimation du quotient (q1,q0)
+	mot q1;
+	mot r;    // reste
+
+	q=(dmot)v*(*carry)+(((dmot)*carry<<LIMB_BITS)|x);
+	q1=(mot)(q>>LIMB_BITS)+1;
+	r=x-q1*y;
+	if (r>(mot)q)
+	{
+		q1--;
+		r+=y;
+	}
+	if (r>=y)
+	{
+		q1++;
+		r-=y;
 	}
 	*carry=r;
-	return x;
+	return q1;
 }
 
 /////////////////////////////////////////////////////////
@@ -66,7 +202,7 @@ static uint8_t SDiv(uint8_t x,uint8_t y,uint8_t*carry)
 // copie "o" dans "d"
 // ne gre pas le recouvrement des origines et destination
 ////////////////////////////////////////
-void LCopy(uint8_t*d,uint8_t so,uint8_t*o)
+void LCopy(mot*d,int so,mot*o)
 {
 	while (so--)
 	{
@@ -74,115 +210,448 @@ void LCopy(uint8_t*d,uint8_t so,uint8_t*o)
 	}
 }
 
+// comparaison de deux longs
+// rend -1, 0 ou 1 selon que "a" est infrieur, gal ou suprieur  "b"
+int LCmp(int sa, mot*a, int sb, mot*b)
+{
+    if (sa!=sb) return sa<sb ? -1 : 1;
+    while (sa--)
+    {
+        if (a[sa]!=b[sa]) return a[sa]<b[sa] ? -1 : 1;
+    }
+    return 0;
+}
+
+// addition de deux longs r = a + b
+// "r" peut tre confondu avec "a" ou "b" ; rend la taille du rsultat
+int LAdd(mot*r, int sa, mot*a, int sb, mot*b)
+{
+    int i;
+    mot t;
+    mot carry;
+    mot*u;
+    if (sa<sb)
+    {   // "a" est le plus long des deux
+        u=a; a=b; b=u;
+        i=sa; sa=sb; sb=i;
+    }
+    carry=0;
+    for (i=0;i<sb;i++)
+    {
+        t=a[i]+carry;
+        carry=(t<carry);
+        t+=b[i];
+        carry+=(t<b[i]);
+        r[i]=t;
+    }
+    for (;i<sa;i++)
+    {
+        t=a[i]+carry;
+        carry=(t<carry);
+        r[i]=t;
+    }
+    if (carry) r[i++]=carry;
+    return i;
+}
+
+// soustraction de deux longs r = a - b, "a" doit tre suprieur ou gal  "b"
+// "r" peut tre confondu avec "a" ou "b" ; rend la taille du rsultat
+int LSub(mot*r, int sa, mot*a, int sb, mot*b)
+{
+    int i;
+    mot t;
+    mot carry;
+    carry=0;
+    for (i=0;i<sb;i++)
+    {
+        t=a[i]-carry;
+        carry=(t>a[i]);
+        carry+=(t<b[i]);
+        r[i]=t-b[i];
+    }
+    for (;i<sa;i++)
+    {
+        t=a[i]-carry;
+        carry=(t>a[i]);
+        r[i]=t;
+    }
+    while ( (sa>0) && (r[sa-1]==0) ) sa--;
+    return sa;
+}
+
+// ligne de multiplication-accumulation d = s + a.x + c
+// "a", "s" et "d" sur "n" chiffres, "d" peut tre confondu avec "s"
+// ou le prcder en mmoire (d = s-1 pour la rduction de Montgomery)
+// rend la retenue sortante
+///////////////////////////////////////////////////////////////////////////
+static mot LMulAdd_c(mot*d, mot*s, mot*a, int n, mot x, mot c)
+{
+	int i;
+	for (i=0;i<n;i++)
+	{
+		d[i]=SMul_a_a(a[i],x,s[i],&c);
+	}
+	return c;
+}
+
+#if (LIMB_BITS==64) && defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+// mme ligne avec MULX, ADCX et ADOX (BMI2 et ADX) : deux chanes de
+// retenues indpendantes, CF pour les chiffres de "s" et OF pour les
+// poids forts des produits. Le compteur de boucle est dcrment par
+// LEA et test par JRCXZ, qui ne touchent pas aux indicateurs.
+static mot LMulAdd_adx(mot*d, mot*s, mot*a, int n, mot x, mot c)
+{
+	mot lo, hi;
+	long k=n;
+	CPT_AJOUTE(smul,n);
+	__asm__ (
+		"xor %k[lo], %k[lo]\n\t"        // CF = OF = 0
+		"1:\n\t"
+		"jrcxz 2f\n\t"
+		"mulx (%[a]), %[lo], %[hi]\n\t"
+		"adcx (%[s]), %[lo]\n\t"
+		"adox %[c], %[lo]\n\t"
+		"mov %[lo], (%[d])\n\t"
+		"mov %[hi], %[c]\n\t"
+		"lea 8(%[a]), %[a]\n\t"
+		"lea 8(%[s]), %[s]\n\t"
+		"lea 8(%[d]), %[d]\n\t"
+		"lea -1(%%rcx), %%rcx\n\t"
+		"jmp 1b\n\t"
+		"2:\n\t"
+		"mov $0, %k[lo]\n\t"
+		"adcx %[lo], %[c]\n\t"
+		"adox %[lo], %[c]\n\t"
+		: [c]"+&r"(c), [lo]"=&r"(lo), [hi]"=&r"(hi),
+		  [a]"+&r"(a), [s]"+&r"(s), [d]"+&r"(d), "+&c"(k)
+		: "d"(x)
+		: "cc", "memory");
+	return c;
+}
+
+static mot (*LMulAdd)(mot*d, mot*s, mot*a, int n, mot x, mot c)=LMulAdd_c;
+
+// choix du noyau selon CPUID (feuille 7 : BMI2 bit 8, ADX bit 19 de ebx)
+// "actif"  0 force le noyau C ; rend 1 si le noyau ADX est en service
+int NoyauAdx(int actif)
+{
+	unsigned int a, b, c, d;
+	LMulAdd=LMulAdd_c;
+	if (!actif) return 0;
+	if (!__get_cpuid_count(7,0,&a,&b,&c,&d)) return 0;
+	if ( ((b>>8)&1) && ((b>>19)&1) ) LMulAdd=LMulAdd_adx;
+	return LMulAdd==LMulAdd_adx;
+}
+
+__attribute__((constructor))
+static void NoyauInit(void)
+{
+	NoyauAdx(1);
+}
+#else
+#define LMulAdd LMulAdd_c
+int NoyauAdx(int actif)
+{
+	(void)actif;
+	return 0;
+}
+#endif
+
 // multiplication de deux longs
 // affecte a "r" le produit de "a" de taille "sa" et de "b" de taille "sb"
 // rend la taille du resultat
 ///////////////////////////////////////////////////////////////////////////
-uint8_t LLMul(uint8_t*r,uint8_t sa, uint8_t*a,uint8_t sb, uint8_t*b)
+int LLMul(mot*r,int sa, mot*a,int sb, mot*b)
 {
-	uint8_t i;
-	uint8_t j;
-	uint8_t carry;
-	uint8_t x;
+	int i;
+	int j;
+	mot carry;
 	if ( (sa==0) || (sb==0) )
 	{ // si l'un des operandes est nul, le resultat l'est aussi
 		return 0;
 	}
-	carry=0;
+	CPT_DEBUT(llmul);
 	// multiplication par le premier chiffre de b
 	// le rsultat a*b[0] est affect au rsultat
-	for (i=0;i<sa;i++)
-	{
-		r[i]=SMul_a_a(a[i],b[0],0,&carry);
-	}
+	for (i=0;i<sa;i++) r[i]=0;
+	carry=LMulAdd(r,r,a,sa,b[0],0);
 	r[sa]=carry;
 	// les produits par les autres chiffres de b, a*b[j]
 	// sont ajouts au rsultat
 	for (j=1;j<sb;++j)
 	{
 		r++;  // criture dcale dans le rsultat
-		carry=0;
-		x=b[j]; // le chiffre de b par lequel il faut multiplier a
-		for (i=0;i<sa;++i)
-		{
-			r[i]=SMul_a_a(a[i],x,r[i],&carry);
-		}
+		carry=LMulAdd(r,r,a,sa,b[j],0);
 		r[sa]=carry;
 	}    
+	CPT_FIN(llmul);
 	// calcul de la taille du rsultat selon la dernire retenue
 	if (carry) return sa+sb;
 	else return sa+sb-1;
 }
 
+// carr d'un long
+// affecte a "r" le carr de "a" de taille "sa"
+// chaque produit crois a[i]*a[j] (i<j) n'est calcul qu'une fois,
+// la somme est double puis les carrs a[i]*a[i] sont ajouts
+// rend la taille du resultat
+///////////////////////////////////////////////////////////////////////////
+int LLSqr(mot*r,int sa, mot*a)
+{
+	int i;
+	mot carry;
+	mot t;
+	if (sa==0) return 0;
+	for (i=0;i<2*sa;i++) r[i]=0;
+	// produits croiss
+	for (i=0;i<sa-1;i++)
+	{
+		r[i+sa]=LMulAdd(r+2*i+1,r+2*i+1,a+i+1,sa-1-i,a[i],0);
+	}
+	// doublement
+	carry=0;
+	for (i=0;i<2*sa;i++)
+	{
+		t=r[i];
+		r[i]=(t<<1)|carry;
+		carry=t>>(LIMB_BITS-1);
+	}
+	// termes diagonaux
+	carry=0;
+	for (i=0;i<sa;i++)
+	{
+		r[2*i]=SMul_a_a(a[i],a[i],r[2*i],&carry);
+		t=r[2*i+1]+carry;
+		carry=(t<carry);
+		r[2*i+1]=t;
+	}
+	// calcul de la taille du rsultat
+	if (r[2*sa-1]) return 2*sa;
+	else return 2*sa-1;
+}
+
+/////////////////////////////////////////////////////////
+// multiplication de Karatsuba
+// a = a1.B^h + a0, b = b1.B^h + b0
+// a.b = z2.B^2h + (z1 - z2 - z0).B^h + z0 avec
+// z0 = a0.b0, z2 = a1.b1, z1 = (a0+a1).(b0+b1)
+// trois multiplications de taille moiti au lieu de quatre.
+// En dessous du seuil kara_seuil (en chiffres), on revient  LLMul.
+// Le seuil se mesure avec "rsa kara" et se fixe par -DKARA_SEUIL=...
+/////////////////////////////////////////////////////////
+
+#ifndef KARA_SEUIL
+#define KARA_SEUIL 32
+#endif
+
+// taille de la zone de travail (en chiffres) ncessaire  LLMulK
+// pour des oprandes d'au plus "s" chiffres
+#define KARA_TEMP(s) (6*(s)+160)
+
+// seuil courant, au moins 4 pour que la rcursion termine
+int kara_seuil=KARA_SEUIL;
+
+// r = r + a sur "sr" chiffres ("a" de taille sa <= sr)
+// rend la retenue
+static mot LAddTo(mot*r, int sr, mot*a, int sa)
+{
+    int i;
+    mot t;
+    mot carry;
+    carry=0;
+    for (i=0;i<sa;i++)
+    {
+        t=r[i]+carry;
+        carry=(t<carry);
+        t+=a[i];
+        carry+=(t<a[i]);
+        r[i]=t;
+    }
+    for (;(i<sr)&&carry;i++)
+    {
+        r[i]+=carry;
+        carry=(r[i]==0);
+    }
+    return carry;
+}
+
+// r = r - a sur "sr" chiffres ("a" de taille sa <= sr)
+// rend la retenue
+static mot LSubFrom(mot*r, int sr, mot*a, int sa)
+{
+    int i;
+    mot t;
+    mot carry;
+    carry=0;
+    for (i=0;i<sa;i++)
+    {
+        t=r[i]-carry;
+        carry=(t>r[i]);
+        carry+=(t<a[i]);
+        r[i]=t-a[i];
+    }
+    for (;(i<sr)&&carry;i++)
+    {
+        carry=(r[i]==0);
+        r[i]--;
+    }
+    return carry;
+}
+
+// produit de "a" et "b", tous deux de "s" chiffres exactement,
+// crit sur les 2s chiffres de "r" ; "w" est la zone de travail
+static void LKara(mot*r, mot*a, mot*b, int s, mot*w)
+{
+    int h;      // taille des poids faibles a0, b0
+    int m;      // taille des poids forts a1, b1 (m >= h)
+    int i;
+    mot*sa;     // a0 + a1 sur m+1 chiffres
+    mot*sb;     // b0 + b1 sur m+1 chiffres
+    mot*z1;     // (a0+a1).(b0+b1) sur 2m+2 chiffres
+
+    if (s<kara_seuil)
+    {
+        LLMul(r,s,a,s,b);
+        return;
+    }
+    h=s/2;
+    m=s-h;
+    sa=w;
+    sb=sa+m+1;
+    z1=sb+m+1;
+    // z0 et z2 directement dans le rsultat
+    LKara(r,a,b,h,w);
+    LKara(r+2*h,a+h,b+h,m,w);
+    LCopy(sa,m,a+h);
+    sa[m]=0;
+    LAddTo(sa,m+1,a,h);
+    LCopy(sb,m,b+h);
+    sb[m]=0;
+    LAddTo(sb,m+1,b,h);
+    LKara(z1,sa,sb,m+1,z1+2*(m+1));
+    // z1 - z0 - z2
+    LSubFrom(z1,2*(m+1),r,2*h);
+    LSubFrom(z1,2*(m+1),r+2*h,2*m);
+    // ajout au milieu du rsultat, ce qui dpasse 2s chiffres est nul
+    i=2*(m+1);
+    if (i>2*s-h) i=2*s-h;
+    LAddTo(r+h,2*s-h,z1,i);
+}
+
+// multiplication de deux longs, par Karatsuba au-del du seuil
+// mme rsultat que LLMul ; "w" est une zone de travail d'au moins
+// KARA_TEMP(max(sa,sb)) chiffres fournie par l'appelant, "r" doit
+// pouvoir recevoir 2.max(sa,sb) chiffres
+int LLMulK(mot*r,int sa, mot*a,int sb, mot*b, mot*w)
+{
+    int s;
+    int i;
+    mot*pa;
+    mot*pb;
+    if ( (sa<kara_seuil) || (sb<kara_seuil) )
+    {
+        return LLMul(r,sa,a,sb,b);
+    }
+    // compltion par des zros  la mme taille
+    s= sa>sb ? sa : sb;
+    pa=a;
+    pb=b;
+    if (sa<s)
+    {
+        pa=w;
+        LCopy(pa,sa,a);
+        for (i=sa;i<s;i++) pa[i]=0;
+        w+=s;
+    }
+    if (sb<s)
+    {
+        pb=w;
+        LCopy(pb,sb,b);
+        for (i=sb;i<s;i++) pb[i]=0;
+        w+=s;
+    }
+    LKara(r,pa,pb,s,w);
+    s=sa+sb;
+    while ( (s>0) && (r[s-1]==0) ) s--;
+    return s;
+}
+
 
 // rend le numero du premier 1 de x a partir de la gauch
 // si x= 00100000 --> rend 
 //       76543210
-static int first_one(int x)
+// x doit tre non nul
+static int first_one(mot x)
 {
 	int count;
-	count=7;
-	while (x<0x80) { --count; x<<=1; }
+	count=LIMB_BITS-1;
+	while (x<MOT_HAUT) { --count; x<<=1; }
 	return count;
 }
 
 
-// dcalage  gauche long de "n" rangs, "n" tant infrieur  8
-static void LShl(int sx, uint8_t*x, int n)
+// dcalage  gauche long de "n" rangs, "n" tant compris entre 1 et LIMB_BITS-1
+static void LShl(int sx, mot*x, int n)
 {
 	int i;
 	for (i=sx-1;i!=0;--i)
 	{
-		x[i] = (x[i]<<n) + ( x[i-1]>>(8-n) ) ;
+		x[i] = (x[i]<<n) + ( x[i-1]>>(LIMB_BITS-n) ) ;
 	}
 	x[0]<<=n;
 }
 
-// dcalage  droite long de "n" rangs, "n" tant infrieur  8
-static void LShr(int sx, uint8_t*x, int n)
+// dcalage  droite long de "n" rangs, "n" tant compris entre 1 et LIMB_BITS-1
+static void LShr(int sx, mot*x, int n)
 {
 	int i;
 	for(i=1;i<sx;i++)
 	{
-		x[i-1]=(x[i-1]>>n) + ( x[i]<<(8-n) );
+		x[i-1]=(x[i-1]>>n) + ( x[i]<<(LIMB_BITS-n) );
 	}
 	x[i-1]>>=n;
 }
 
 
-// division euclidienne d'un entier long par un entier long
-// divise "a" (taille "*psa") par "b" (taille "sb")
+// division euclidienne par un diviseur dj normalis
+// divise "a" (taille "*psa") par "b" (taille "sb") : "b" est le diviseur
+// dcal de "count" rangs  gauche, son bit de poids fort est  1,
+// il n'est pas modifi
 // le reste est ecrit dans *psa (taille) et a  (chiffres)
-// le quotient est ignor
+// si "q" n'est pas nul, le quotient y est crit et sa taille dans *psq
 // "b" doit avoir au moins deux chiffres (taille "sb" >=2, donc non nul !)
-// et "a" doit etre superieur a "b";
 //
-void Modulo(uint8_t*psa,uint8_t*a,int sb,uint8_t*b)
+static void DivNorm(int*psq, mot*q, int*psa, mot*a, int sb, mot*b, int count)
 {
-    int        count;   // decalage de normalisation
     int        i,k;
     int        sa;
-    uint8_t    qp;
-    uint8_t    qc[2];
-    uint8_t    rc[2];
-    uint8_t    t;
+    mot        qp;
+    mot        qc[2];
+    mot        rc[2];
+    mot        t;
     int        sq;
-    uint8_t    ah;      // poids fort de a
-    uint8_t    rem;
-    uint8_t    carry;
+    mot        ah;      // poids fort de a
+    mot        rem;
+    mot        carry;
+    mot        inv;     // inverse du chiffre de poids fort de b
 
     sa=*psa;
-    if (sa<sb) return;
+    if (sa<sb)
+    {
+        if (q!=NULL) *psq=0;
+        return;
+    }
+    if (q!=NULL)
+    {   // taille maxi du quotient
+        for (i=0;i<=sa-sb;i++) q[i]=0;
+        *psq=sa-sb+1;
+    }
 
-    // determiner le decalage de normalisation
-    count=8-1-first_one(b[sb-1]);
     if (count>0)
     {
-        // normaliser le diviseur, c'est--dire faire en sorte que
-        // le bit de poids fort du premier chiffre de b soit 1
-        LShl(sb,b,count);
         // normaliser le dividende
-        ah=a[sa-1]>>(8-count);
+        ah=a[sa-1]>>(LIMB_BITS-count);
         LShl(sa,a,count);
     }
     else ah=0;
@@ -193,19 +662,20 @@ void Modulo(uint8_t*psa,uint8_t*a,int sb,uint8_t*b)
         ah=a[--sa-1];
     }
     sq=sa-sb; // taille du quotient
+    inv=MotInv(b[sb-1]);
     for (k=sq;k;--k) // boucle principale
     {
         // estimation du quotient partiel
         if (ah==b[sb-1])
         {
-            qp=0xff;
+            qp=MOT_MAX;
             rem=ah+a[sa-2];
             if (rem<ah) goto soustraire;
         }
         else
         {
             rem=ah;
-            qp=SDiv(a[sa-2],b[sb-1],&rem);
+            qp=SDivInv(a[sa-2],b[sb-1],inv,&rem);
         }
         // correction
         rc[0]=a[sa-3];
@@ -215,6 +685,7 @@ void Modulo(uint8_t*psa,uint8_t*a,int sb,uint8_t*b)
         qc[1]=carry;
         while ( (qc[1] > rc[1]) || ( (qc[1] == rc[1]) && (qc[0] > rc[0]) ) )
         {
+            CPT_INC(correction);
             --qp;
             if ( qc[0]<b[sb-2] ) --qc[1];
             qc[0]-=b[sb-2];
@@ -235,6 +706,7 @@ void Modulo(uint8_t*psa,uint8_t*a,int sb,uint8_t*b)
             // derniere correction si ncessaire
             if (carry>ah)
             {
+                CPT_INC(rajout);
                 qp--;
                 carry=0;
                 for (i=0;i<sb;i++)
@@ -247,17 +719,15 @@ void Modulo(uint8_t*psa,uint8_t*a,int sb,uint8_t*b)
                 }
             }
         }
+        if (q!=NULL) q[k-1]=qp;
         sa--;
         ah=a[sa-1];
     }
     while ( (sa>0) && (a[sa-1]==0) ) sa--;
-    // denormalisation
+    // denormalisation du reste
     if (count>0)
-    {   // du reste
+    {
         LShr(sa,a,count);
-        // du dividende pour qu'il soit gal  ce qu'il tait
-        // lors de l'appel
-        LShr(sb,b,count);
     }
     // affectation taille du reste
     *psa=sa;
@@ -265,226 +735,4509 @@ void Modulo(uint8_t*psa,uint8_t*a,int sb,uint8_t*b)
     {
         if (a[sa-1]==0) --*psa;
     }
+    if (q!=NULL)
+    {
+        while ( (*psq>0) && (q[*psq-1]==0) ) --*psq;
+    }
 }
 
-// variables globales
-////////////////////
-
-// Taille maxi du modulo en nombre d'octets
-#define MAX 32
+// division euclidienne d'un entier long par un entier long
+// divise "a" (taille "*psa") par "b" (taille "sb")
+// le reste est ecrit dans *psa (taille) et a  (chiffres)
+// le quotient est crit dans "q" (taille *psq, au plus *psa-sb+1 chiffres)
+// "b" est normalis sur place puis restaur
+// "b" doit avoir au moins deux chiffres (taille "sb" >=2, donc non nul !)
+//
+void LDiv(int*psq, mot*q, int*psa, mot*a, int sb, mot*b)
+{
+    int        count;   // decalage de normalisation
 
-// le modulo n
-uint8_t sn;
-uint8_t n[MAX];
+    if (*psa<sb)
+    {
+        *psq=0;
+        return;
+    }
+    // determiner le decalage de normalisation
+    count=LIMB_BITS-1-first_one(b[sb-1]);
+    // normaliser le diviseur, c'est--dire faire en sorte que
+    // le bit de poids fort du premier chiffre de b soit 1
+    if (count>0) LShl(sb,b,count);
+    DivNorm(psq,q,psa,a,sb,b,count);
+    // denormalisation du diviseur pour qu'il soit gal  ce qu'il
+    // tait lors de l'appel
+    if (count>0) LShr(sb,b,count);
+}
 
+// division euclidienne d'un entier long par un entier long
+// divise "a" (taille "*psa") par "b" (taille "sb")
+// le reste est ecrit dans *psa (taille) et a  (chiffres)
+// le quotient est ignor
+// "b" doit avoir au moins deux chiffres (taille "sb" >=2, donc non nul !)
+// et "a" doit etre superieur a "b";
+//
+void Modulo(int*psa,mot*a,int sb,mot*b)
+{
+    int        count;   // decalage de normalisation
 
+    if (*psa<sb) return;
+    CPT_DEBUT(modulo);
+    count=LIMB_BITS-1-first_one(b[sb-1]);
+    if (count>0) LShl(sb,b,count);
+    DivNorm(NULL,NULL,psa,a,sb,b,count);
+    if (count>0) LShr(sb,b,count);
+    CPT_FIN(modulo);
+}
 
-// Multiplication modulo n = multiplication suivi d'une division Euclidienne
-// a = a*b mod n
-// Le modulo est la variable globale (sn,n)
-uint8_t LLMulMod(uint8_t sa, uint8_t*a, uint8_t sb, uint8_t*b)
-{
-    uint8_t sp;
-    uint8_t p[2*MAX]; // l o est calcul le produit
-    sp=LLMul(p,sa,a,sb,b);
-    Modulo(&sp,p,sn,n);
-    LCopy(a,sp,p);
-    return sp;
+// division d'un long par un chiffre non nul "b"
+// le quotient est crit dans "q" (taille *psq) ; rend le reste
+static mot LDivMot(int*psq, mot*q, int sa, mot*a, mot b)
+{
+    int i;
+    dmot r;
+    r=0;
+    for (i=sa-1;i>=0;i--)
+    {
+        r=(r<<LIMB_BITS)|a[i];
+        q[i]=(mot)(r/b);
+        r%=b;
+    }
+    while ( (sa>0) && (q[sa-1]==0) ) sa--;
+    *psq=sa;
+    return (mot)r;
 }
 
-// Elvation de x  la puissance e, modulo n (variable globale) rsultat dans r
-// rend la taille du rsultat.
-uint8_t LLExpMod(uint8_t*r, uint8_t sx, uint8_t*x, uint8_t se, uint8_t*e)
+// division euclidienne comme LDiv, "b" pouvant n'avoir qu'un chiffre
+static void LDivQ(int*psq, mot*q, int*psa, mot*a, int sb, mot*b)
 {
-    uint8_t sr;         // taille du rsultat
-    uint8_t flag;       // initialis  0 et mis  1 quand le rsultat est diffrent de 1
-    uint8_t t; // chiffre courant de l'exposant
-    uint8_t msk; // masque du bit de l'exposant
-    // algorithme avec rgle de Horner
-    flag=0;
-    sr=1;
-    r[0]=1; // initialisation par dfaut r <-- 1
-    while(se!=0)
-    { // boucle sur les bits de n du poids fort vers le poids vaible
-        t=e[--se];
-        for (msk=0x80;msk!=0;msk>>=1)
-        {
-            if (flag!=0)
-            {
-                sr=LLMulMod(sr,r,sr,r);
-            }
-            if ((t&msk)!=0)
-            {
-                sr=LLMulMod(sr,r,sx,x);
-                flag=1;                       // maintenant, il faut lever au carr
-            }
-        }
+    if (sb==1)
+    {
+        a[0]=LDivMot(psq,q,*psa,a,b[0]);
+        *psa=(a[0]!=0);
     }
-    return sr;
+    else LDiv(psq,q,psa,a,sb,b);
 }
 
+// contexte de calcul modulo n
+////////////////////////////////
 
+// Taille maxi du modulo en bits
+#ifndef MAX_BITS
+#define MAX_BITS 4096
+#endif
+// Taille maxi du modulo en nombre d'octets
+#define MAX_OCTETS (MAX_BITS/8)
+// Taille maxi du modulo en nombre de chiffres
+#define MAX (MAX_BITS/LIMB_BITS)
 
-//
-// fonction de lecture et d'affichage en hexadcimal
-// ncessaire uniquement pour le mode console
-//////////////////////////////////////////////////////
+// taille maxi de la fentre de LLExpModFen
+#define FEN_MAX 6
 
-// convertit un caractre ascii en uint8_t
-// si le caractre ascii ne correspond pas  un chiffre, rend le mot tout  1
-uint8_t digit(char c)
+/////////////////////////////////////////////////////////
+// pgcd et inverse modulaire par la mthode de Lehmer
+// Les tapes d'Euclide ne dpendent au dbut que des chiffres de poids
+// fort : on les simule sur x^ et y^, les LIMB_BITS bits de tte de x et
+// les bits de mme rang de y, en accumulant les cofacteurs dans la
+// matrice (A B ; C D) tant que les quotients de (x^+A)/(y^+C) et de
+// (x^+B)/(y^+D) concident (Knuth, algorithme L). La matrice est
+// ensuite applique en une fois aux longs : quatre produits par un
+// chiffre au lieu d'une division longue par tape. Si aucune tape
+// n'est sre, on fait une vraie division (LDivQ).
+// A et D sont de mme signe, B et C du signe oppos ; les restes sont
+// positifs et les cofacteurs de "a" alternent en signe : on ne manipule
+// que des valeurs absolues.
+/////////////////////////////////////////////////////////
+
+// produit d'un long par un chiffre r = a.x ; rend la taille de r
+static int LMulMot(mot*r, int sa, mot*a, mot x)
 {
-	if ( (c>='0') && (c<='9') ) return c-'0';
-	if ( (c>='a') && (c<='z') ) return c-'a'+10;
-	if ( (c>='A') && (c<='Z') ) return c-'A'+10;
-	return (uint8_t)-1;
+    int i;
+    mot carry;
+    if ( (sa==0) || (x==0) ) return 0;
+    carry=0;
+    for (i=0;i<sa;i++) r[i]=SMul_a_a(a[i],x,0,&carry);
+    r[sa]=carry;
+    return carry ? sa+1 : sa;
 }
 
-// dcalage de 4 symboles binaires vers la gauche
-/////////////////////////////////////////////////
-int LShl4(int sx, uint8_t*x)
+// LIMB_BITS bits de "x"  partir du bit "pos"
+static mot LExtrait(int sx, mot*x, int pos)
 {
-    int i;
-    uint8_t c;
-    uint8_t t;
-    c=0;
-    for (i=0;i<sx;i++)
+    int w, b;
+    mot v;
+    w=pos/LIMB_BITS;
+    b=pos%LIMB_BITS;
+    if (w>=sx) return 0;
+    v=x[w]>>b;
+    if ( (b>0) && (w+1<sx) ) v|=x[w+1]<<(LIMB_BITS-b);
+    return v;
+}
+
+// r = |a.x - b.y|, "r" de taille au moins max(sx,sy)+1 ; rend la taille
+static int LCombine(mot*r, mot a, int sx, mot*x, mot b, int sy, mot*y)
+{
+    int s1; mot p1[MAX+2];
+    int s2; mot p2[MAX+2];
+    s1=LMulMot(p1,sx,x,a);
+    s2=LMulMot(p2,sy,y,b);
+    if (LCmp(s1,p1,s2,p2)>=0) return LSub(r,s1,p1,s2,p2);
+    return LSub(r,s2,p2,s1,p1);
+}
+
+// r = a.x + b.y ; rend la taille
+static int LCombineAdd(mot*r, mot a, int sx, mot*x, mot b, int sy, mot*y)
+{
+    int s1; mot p1[MAX+2];
+    int s2; mot p2[MAX+2];
+    s1=LMulMot(p1,sx,x,a);
+    s2=LMulMot(p2,sy,y,b);
+    return LAdd(r,s1,p1,s2,p2);
+}
+
+// algorithme d'Euclide tendu de Lehmer sur (m, a), a <= m
+// crit pgcd(a,m) dans "g" (taille au moins sm) et rend sa taille ;
+// si "u" n'est pas nul, y crit |u| avec u.a = pgcd(a,m) mod m, et dans
+// *pneg 1 si u est ngatif
+static int LEuclide(mot*g, int sa, mot*a, int sm, mot*m, int*psu, mot*u, int*pneg)
+{
+    int sx; mot x[MAX+2];       // restes successifs
+    int sy; mot y[MAX+2];
+    int s0; mot u0[MAX+2];      // cofacteurs de "a", en valeur absolue
+    int s1; mot u1[MAX+2];
+    int st; mot t[MAX+2];
+    int sq; mot q[MAX+2];
+    int k;                      // nombre d'tapes d'Euclide
+    int j;
+    int pos;
+    smot xh, yh;
+    smot A, B, C, D, qh, th;
+
+    sx=sm; LCopy(x,sm,m);
+    sy=sa; LCopy(y,sa,a);
+    s0=0;
+    s1=1; u1[0]=1;
+    k=0;
+    while (sy!=0)
     {
-        t=x[i];
-        x[i]=(x[i]<<4)+c;
-        c=t>>4;
+        pos=(sx-2)*LIMB_BITS+first_one(x[sx-1])+1;   // nbits(x)-LIMB_BITS
+        if (pos<0) pos=0;
+        xh=LExtrait(sx,x,pos);
+        yh=LExtrait(sy,y,pos);
+        A=1; B=0; C=0; D=1;
+        j=0;
+        while ( (yh+C!=0) && (yh+D!=0) )
+        {
+            qh=(xh+A)/(yh+C);
+            if (qh!=(xh+B)/(yh+D)) break;
+            th=A-qh*C; A=C; C=th;
+            th=B-qh*D; B=D; D=th;
+            th=xh-qh*yh; xh=yh; yh=th;
+            j++;
+        }
+        if (B==0)
+        {   // pas d'tape sre : (x, y) = (y, x mod y)
+            LDivQ(&sq,q,&sx,x,sy,y);
+            st=sx; LCopy(t,sx,x);
+            sx=sy; LCopy(x,sy,y);
+            sy=st; LCopy(y,st,t);
+            if (u!=NULL)
+            {   // (u0, u1) = (u1, u0 + q.u1)
+                st=LLMul(t,sq,q,s1,u1);
+                st=LAdd(t,st,t,s0,u0);
+                s0=s1; LCopy(u0,s1,u1);
+                s1=st; LCopy(u1,st,t);
+            }
+            k++;
+            continue;
+        }
+        // j tapes d'un coup
+        if (A<0) A=-A;
+        if (B<0) B=-B;
+        if (C<0) C=-C;
+        if (D<0) D=-D;
+        st=LCombine(t,(mot)A,sx,x,(mot)B,sy,y);
+        sy=LCombine(y,(mot)C,sx,x,(mot)D,sy,y);
+        sx=st; LCopy(x,st,t);
+        if (u!=NULL)
+        {
+            st=LCombineAdd(t,(mot)A,s0,u0,(mot)B,s1,u1);
+            s1=LCombineAdd(u1,(mot)C,s0,u0,(mot)D,s1,u1);
+            s0=st; LCopy(u0,st,t);
+        }
+        k+=j;
     }
-    if (c!=0)
+    LCopy(g,sx,x);
+    if (u!=NULL)
     {
-        x[i++]=c;
+        *psu=s0; LCopy(u,s0,u0);
+        *pneg=(k&1)==0;     // ngatif si k est pair
     }
-    return i;
+    return sx;
 }
 
-// fonctions de conversion chaine hexa --> nombre
-// rend le nombre de digits
-int AToL(uint8_t*r,char*s)
+// plus grand commun diviseur r = pgcd(a,b)
+// "a" et "b" non nuls, "r" de taille au moins min(sa,sb) ; rend la taille de r
+int LPgcd(mot*r, int sa, mot*a, int sb, mot*b)
 {
-    uint8_t d;
-    int sr;
-    sr=0;
-    d=digit(*(s++));
-    if (d<16) r[0]=0;
-    while (d<16)
-    {
-        sr=LShl4(sr,r);
-        r[0]+=d; // ajouter le chiffre courant
-        if (sr==0)
-        {   // ajuster la taille
-            if (d!=0) sr++;
-        }
-        d=digit(*(s++)); // pour le tour suivant
-    }
-    return sr;
+    if (LCmp(sa,a,sb,b)>0) return LEuclide(r,sb,b,sa,a,NULL,NULL,NULL);
+    return LEuclide(r,sa,a,sb,b,NULL,NULL,NULL);
 }
 
-// affichage d'un entier en hexadcimal
-///////////////////////////////////////
-void affiche_hexa(int sx,uint8_t*x)
+// inverse modulaire r = a^-1 mod m
+// "a" infrieur  "m", "r" de taille au moins sm
+// rend la taille de l'inverse, ou -1 si pgcd(a,m) est diffrent de 1
+int LInvMod(mot*r, int sa, mot*a, int sm, mot*m)
 {
-	while (--sx>=0)
-	{
-		// affichage du chiffre de poids fort au chiffre de poids faible
-		printf("%02x",x[sx]);
-	}
-	printf("\n");
-} 
+    int sg; mot g[MAX+2];
+    int su; mot u[MAX+2];
+    int neg;
+
+    sg=LEuclide(g,sa,a,sm,m,&su,u,&neg);
+    if ( (sg!=1) || (g[0]!=1) ) return -1;
+    if (neg) su=LSub(u,sm,m,su,u);
+    LCopy(r,su,u);
+    return su;
+}
 
-int test_rsa(char*hn, char*hd, char*he, char*m)
+// plus petit commun multiple r = a.b / pgcd(a,b)
+// "a" et "b" non nuls, "r" de taille au moins sa+sb ; rend la taille de r
+int LPpcm(mot*r, int sa, mot*a, int sb, mot*b)
 {
-    // Exposant priv
-    uint8_t sd;
-    uint8_t d[MAX];
-    // Exposant public
-    uint8_t se;
-    uint8_t e[4];
+    int sg; mot g[MAX+1];
+    int st; mot t[MAX+1];
+    int sq; mot q[MAX+1];
 
-    // Message clair
-    uint8_t sx; uint8_t x[MAX];
+    sg=LPgcd(g,sa,a,sb,b);
+    st=sa; LCopy(t,sa,a);
+    LDivQ(&sq,q,&st,t,sg,g);
+    return LLMul(r,sq,q,sb,b);
+}
 
-    // Cryptogramme
-    uint8_t sy; uint8_t y[MAX+1];
+// Constantes prcalcules d'un modulo
+// Elles ne dpendent que du modulo : elles sont calcules une seule fois
+// par cl et conserves dans un cache index par une empreinte des
+// chiffres du modulo. Une entre n'est plus modifie aprs sa cration,
+// elle peut donc tre partage sans verrou par tous les contextes et
+// tous les fils qui utilisent la mme cl.
+typedef struct
+{
+    uint64_t h;         // empreinte du modulo
+    int  sn;            // taille du modulo
+    int  count;         // dcalage de normalisation du modulo
+    mot  np;            // -n^-1 mod B (Montgomery), 0 si n est pair
+    int  smu;           // taille de mu
+    mot  n[MAX];        // le modulo n
+    mot  nn[MAX];       // le modulo normalis n << count (division)
+    mot  r2[MAX];       // R^2 mod n sur sn chiffres (Montgomery)
+    mot  mu[MAX+2];     // mu = B^2sn / n (Barrett)
+} precalc;
 
-    // Message dchiffr
-    uint8_t st; uint8_t t[MAX];
+// mthodes de rduction d'un contexte
+#define RED_DIVISION   0   // division euclidienne (Modulo)
+#define RED_BARRETT    1   // rduction de Barrett
+#define RED_MONTGOMERY 2   // exponentiation dans le domaine de Montgomery
+
+// Le contexte regroupe le modulo, ses constantes de rduction
+// prcalcules et les zones de travail, dimensionnes  la taille de
+// la cl. Toutes les oprations modulaires le prennent en paramtre :
+// aucune variable globale n'est modifie, plusieurs cls peuvent tre
+// utilises en mme temps. Un contexte ne sert qu' un seul fil
+// d'excution  la fois (ses zones de travail sont partages) ;
+// chaque fil cre le sien, les constantes venant du cache.
+
+// produit de Montgomery  taille fixe r = a.b.R^-1 mod n
+typedef void (*mont_fixe)(mot*r, mot*a, mot*b, mot*n, mot np);
+
+typedef struct
+{
+    precalc* pc;    // constantes du modulo (cache, lecture seule)
+    int  sn;        // taille du modulo
+    mot* n;         // le modulo n (pc->n)
+    mot  np;        // -n^-1 mod B (Montgomery), 0 si n est pair
+    mot* r2;        // R^2 mod n sur sn chiffres (pc->r2)
+    int  red;       // mthode de rduction, RED_DIVISION par dfaut
+    mont_fixe mf;   // produit de Montgomery  la taille du modulo, ou NULL
+    // zones de travail
+    mot* p;         // produit, 2sn+2 chiffres
+    mot* w;         // Karatsuba, KARA_TEMP(sn) chiffres
+    mot* t;         // produit de Montgomery, sn+2 chiffres
+    mot* a;         // oprande rduit, 2sn+2 chiffres
+    mot* u;         // constante 1 sur sn chiffres
+    mot* tab;       // table des puissances impaires et x^2, (2^(FEN_MAX-1)+1).sn chiffres
+    mot* b;         // rduction de Barrett, 3sn+5 chiffres
+} ctx_mod;
+
+static mot MontN0(mot n0);
+static mont_fixe MontFixe(int sn);
+int CtxInitPc(ctx_mod*c, precalc*pc);
+
+// cache des constantes : table de hachage  chanage
+#define CACHE_NB 64
+typedef struct entree_cache
+{
+    precalc pc;
+    struct entree_cache* suivant;
+} entree_cache;
+static entree_cache* cache[CACHE_NB];
+static pthread_mutex_t cache_verrou=PTHREAD_MUTEX_INITIALIZER;
+
+// empreinte FNV-1a des chiffres du modulo
+static uint64_t LHash(int sn, mot*n)
+{
+    uint64_t h;
+    int i,j;
+    h=0xcbf29ce484222325ull;
+    for (i=0;i<sn;i++)
+    {
+        for (j=0;j<MOT_OCTETS;j++)
+        {
+            h^=(uint8_t)(n[i]>>(8*j));
+            h*=0x100000001b3ull;
+        }
+    }
+    return h;
+}
+
+// calcul de toutes les constantes du modulo "n" de taille "sn"
+static void PrecalcCalcule(precalc*pc, uint64_t h, int sn, mot*n)
+{
+    int i;
+    int sp;
+    mot p[2*MAX+1];
+
+    pc->h=h;
+    pc->sn=sn;
+    LCopy(pc->n,sn,n);
+    // normalisation du modulo
+    pc->count=LIMB_BITS-1-first_one(n[sn-1]);
+    LCopy(pc->nn,sn,n);
+    if (pc->count>0) LShl(sn,pc->nn,pc->count);
+    // mu = B^2sn / n
+    for (i=0;i<2*sn;i++) p[i]=0;
+    p[2*sn]=1;
+    sp=2*sn+1;
+    DivNorm(&pc->smu,pc->mu,&sp,p,sn,pc->nn,pc->count);
+    // constantes de Montgomery : n' et R^2 mod n
+    pc->np=0;
+    for (i=0;i<sn;i++) pc->r2[i]=0;
+    if (n[0]&1)
+    {
+        pc->np=MontN0(n[0]);
+        // B^2sn mod n est le reste de la division prcdente
+        LCopy(pc->r2,sp,p);
+    }
+}
+
+// recherche des constantes du modulo dans le cache
+// elles sont calcules et ajoutes si la cl est nouvelle
+// rend NULL si l'allocation choue
+precalc* CacheCherche(int sn, mot*n)
+{
+    uint64_t h;
+    entree_cache* e;
+
+    h=LHash(sn,n);
+    pthread_mutex_lock(&cache_verrou);
+    for (e=cache[h%CACHE_NB];e!=NULL;e=e->suivant)
+    {
+        if ( (e->pc.h==h) && (LCmp(e->pc.sn,e->pc.n,sn,n)==0) ) break;
+    }
+    if (e==NULL)
+    {
+        e=malloc(sizeof(entree_cache));
+        if (e!=NULL)
+        {
+            PrecalcCalcule(&e->pc,h,sn,n);
+            e->suivant=cache[h%CACHE_NB];
+            cache[h%CACHE_NB]=e;
+        }
+    }
+    pthread_mutex_unlock(&cache_verrou);
+    return e==NULL ? NULL : &e->pc;
+}
+
+// vidage du cache
+// aucun contexte ne doit plus utiliser les constantes libres
+void CacheVide(void)
+{
+    int i;
+    entree_cache* e;
+    pthread_mutex_lock(&cache_verrou);
+    for (i=0;i<CACHE_NB;i++)
+    {
+        while (cache[i]!=NULL)
+        {
+            e=cache[i];
+            cache[i]=e->suivant;
+            free(e);
+        }
+    }
+    pthread_mutex_unlock(&cache_verrou);
+}
+
+// initialisation du contexte pour le modulo "n" de taille "sn"
+// les constantes viennent du cache ; rend 0, ou -1 si la taille est
+// hors limite ou si l'allocation choue
+int CtxInit(ctx_mod*c, int sn, mot*n)
+{
+    precalc*pc;
+    if ( (sn<2) || (sn>MAX) || (n[sn-1]==0) ) return -1;
+    pc=CacheCherche(sn,n);
+    if (pc==NULL) return -1;
+    return CtxInitPc(c,pc);
+}
+
+// initialisation d'un contexte  partir de constantes dj calcules
+// (cache ou magasin de cls), qui ne sont pas copies ; rend 0 ou -1
+int CtxInitPc(ctx_mod*c, precalc*pc)
+{
+    int nb;
+    int i;
+    int sn;
+    mot*z;
+
+    sn=pc->sn;
+    if ( (sn<2) || (sn>MAX) ) return -1;
+    c->pc=pc;
+    nb=(2*sn+2)+KARA_TEMP(sn)+(sn+2)+(2*sn+2)+sn+((1<<(FEN_MAX-1))+1)*sn+(3*sn+5);
+    z=malloc(nb*sizeof(mot));
+    if (z==NULL) return -1;
+    c->sn=sn;
+    c->n=c->pc->n;
+    c->np=c->pc->np;
+    c->r2=c->pc->r2;
+    c->p=z;   z+=2*sn+2;
+    c->w=z;   z+=KARA_TEMP(sn);
+    c->t=z;   z+=sn+2;
+    c->a=z;   z+=2*sn+2;
+    c->u=z;   z+=sn;
+    c->tab=z; z+=((1<<(FEN_MAX-1))+1)*sn;
+    c->b=z;
+    c->red=RED_DIVISION;
+    c->mf= c->np!=0 ? MontFixe(sn) : NULL;
+    for (i=0;i<sn;i++) c->u[i]=0;
+    c->u[0]=1;
+    return 0;
+}
+
+// libration des zones du contexte
+void CtxLibere(ctx_mod*c)
+{
+    free(c->p);
+    c->p=NULL;
+    c->sn=0;
+}
+
+// choix de la mthode de rduction du contexte
+// RED_DIVISION ou RED_BARRETT pour LLMulMod et LLSqrMod,
+// RED_MONTGOMERY pour LLExpModCtx (division pour le reste)
+void CtxReduction(ctx_mod*c, int red)
+{
+    c->red=red;
+}
+
+/////////////////////////////////////////////////////////
+// rduction de Barrett
+// avec k = sn et mu = B^2k / n prcalcul, pour x < B^2k :
+//   q = ((x / B^(k-1)) . mu) / B^(k+1)   (q <= x/n <= q+2)
+//   r = (x - q.n) mod B^(k+1)
+//   tant que r >= n : r = r - n          (au plus deux fois)
+// seulement des multiplications, pas d'estimation de quotient.
+/////////////////////////////////////////////////////////
+
+// produit tronqu r = a.b mod B^s (les "s" chiffres de poids faible)
+static void LMulBas(mot*r, int s, int sa, mot*a, int sb, mot*b)
+{
+    int i,j;
+    mot carry;
+    for (i=0;i<s;i++) r[i]=0;
+    for (j=0;(j<sb)&&(j<s);j++)
+    {
+        carry=0;
+        for (i=0;(i<sa)&&(i+j<s);i++)
+        {
+            r[i+j]=SMul_a_a(a[i],b[j],r[i+j],&carry);
+        }
+        if (i+j<s) r[i+j]=carry;
+    }
+}
+
+// a = a mod n par la mthode de Barrett
+// "a" (taille *psa) doit avoir au plus 2sn chiffres et de la place
+// pour sn+1 chiffres
+static void Barrett(ctx_mod*c, int*psa, mot*a)
+{
+    int k;
+    int sa;
+    int sq;
+    int i;
+    mot*q;      // q1.mu puis q3 = ses chiffres de rang >= k+1
+    mot*r2;     // q3.n mod B^(k+1)
+
+    k=c->sn;
+    sa=*psa;
+    if (sa<k) return; // a < B^(k-1) <= n
+    q=c->b;
+    r2=c->b+2*k+4;
+    // q3 = ((a / B^(k-1)) . mu) / B^(k+1)
+    sq=LLMul(q,sa-(k-1),a+k-1,c->pc->smu,c->pc->mu)-(k+1);
+    // r = (a - q3.n) mod B^(k+1)
+    for (i=sa;i<=k;i++) a[i]=0;
+    if (sq>0)
+    {
+        LMulBas(r2,k+1,sq,q+k+1,k,c->n);
+        LSubFrom(a,k+1,r2,k+1);
+    }
+    // au plus deux soustractions
+    while ( (a[k]!=0) || (LCmp(k,a,k,c->n)>=0) )
+    {
+        a[k]-=LSubFrom(a,k,c->n,k);
+    }
+    sa=k;
+    while ( (sa>0) && (a[sa-1]==0) ) sa--;
+    *psa=sa;
+}
+
+// rduction modulo n : a = a mod n
+// par la mthode de Barrett si elle est choisie et que "a" a au plus
+// 2sn chiffres, sinon par division avec le modulo normalis du cache,
+// qui n'est pas modifi
+static void ModuloCtx(ctx_mod*c, int*psa, mot*a)
+{
+    CPT_DEBUT(modulo);
+    if ( (c->red==RED_BARRETT) && (*psa<=2*c->sn) )
+    {
+        Barrett(c,psa,a);
+    }
+    else DivNorm(NULL,NULL,psa,a,c->sn,c->pc->nn,c->pc->count);
+    CPT_FIN(modulo);
+}
+
+
+// Carr modulo n = carr suivi d'une division Euclidienne
+// a = a*a mod n, "a" de taille au plus sn
+int LLSqrMod(ctx_mod*c, int sa, mot*a)
+{
+    int sp;
+    sp=LLSqr(c->p,sa,a);
+    ModuloCtx(c,&sp,c->p);
+    LCopy(a,sp,c->p);
+    return sp;
+}
+
+// Multiplication modulo n = multiplication suivi d'une division Euclidienne
+// a = a*b mod n, "a" et "b" de taille au plus sn
+// si "a" et "b" sont le mme long, le carr est calcul par LLSqrMod
+int LLMulMod(ctx_mod*c, int sa, mot*a, int sb, mot*b)
+{
+    int sp;
+    if ( (a==b) && (sa==sb) ) return LLSqrMod(c,sa,a);
+    sp=LLMulK(c->p,sa,a,sb,b,c->w);
+    ModuloCtx(c,&sp,c->p);
+    LCopy(a,sp,c->p);
+    return sp;
+}
+
+// Elvation de x  la puissance e, modulo n rsultat dans r
+// "x" de taille au plus sn ; rend la taille du rsultat.
+int LLExpMod(ctx_mod*c, mot*r, int sx, mot*x, int se, mot*e)
+{
+    int sr;         // taille du rsultat
+    int flag;       // initialis  0 et mis  1 quand le rsultat est diffrent de 1
+    mot t; // chiffre courant de l'exposant
+    mot msk; // masque du bit de l'exposant
+    CPT_DEBUT(llexpmod);
+    // algorithme avec rgle de Horner
+    flag=0;
+    sr=1;
+    r[0]=1; // initialisation par dfaut r <-- 1
+    while(se!=0)
+    { // boucle sur les bits de n du poids fort vers le poids vaible
+        t=e[--se];
+        for (msk=MOT_HAUT;msk!=0;msk>>=1)
+        {
+            if (flag!=0)
+            {
+                sr=LLMulMod(c,sr,r,sr,r);
+            }
+            if ((t&msk)!=0)
+            {
+                sr=LLMulMod(c,sr,r,sx,x);
+                flag=1;                       // maintenant, il faut lever au carr
+            }
+        }
+    }
+    CPT_FIN(llexpmod);
+    return sr;
+}
+
+/////////////////////////////////////////////////////////
+// exponentiation par fentre glissante
+// Les puissances impaires x^1, x^3, ..., x^(2^w-1) sont prcalcules ;
+// l'exposant est parcouru par fentres de au plus w bits commenant et
+// finissant par un 1, soit environ nbits/(w+1) multiplications au lieu
+// d'une par bit  1.
+/////////////////////////////////////////////////////////
+
+// rend le bit "i" de l'exposant "e"
+static int LBit(mot*e, int i)
+{
+    return (e[i/LIMB_BITS]>>(i%LIMB_BITS))&1;
+}
+
+// rend le nombre de bits significatifs de "x" (taille "sx")
+int LBits(int sx, mot*x)
+{
+    if (sx==0) return 0;
+    return (sx-1)*LIMB_BITS+first_one(x[sx-1])+1;
+}
+
+// taille de la fentre selon le nombre de bits de l'exposant
+static int FenTaille(int nbits)
+{
+    if (nbits>671) return 6;
+    if (nbits>239) return 5;
+    if (nbits>79)  return 4;
+    if (nbits>23)  return 3;
+    return 1;
+}
+
+// Elvation de x  la puissance e, modulo n rsultat dans r
+// "x" de taille au plus 2sn ;
+// mme rsultat que LLExpMod ; rend la taille du rsultat.
+int LLExpModFen(ctx_mod*c, mot*r, int sx, mot*x, int se, mot*e)
+{
+    int sr;                           // taille du rsultat
+    mot*tab;                          // tab[k] = x^(2k+1) mod n, sn chiffres chacun
+    int stab[1<<(FEN_MAX-1)];         // tailles des lments de tab
+    mot*x2;                           // x^2 mod n
+    int sx2;
+    int sn;
+    int sp;
+    int w;                            // taille de la fentre
+    int i,l,k;
+    int val;                          // valeur de la fentre (impaire)
+    int flag;                         // mis  1 quand r est initialis
+
+    sn=c->sn;
+    tab=c->tab;
+    x2=tab+(1<<(FEN_MAX-1))*sn;
+    // prcalcul des puissances impaires
+    LCopy(c->a,sx,x);
+    sp=sx;
+    ModuloCtx(c,&sp,c->a);
+    LCopy(tab,sp,c->a);
+    stab[0]=sp;
+    i=LBits(se,e);
+    w=FenTaille(i);
+    if (w>1)
+    {
+        LCopy(x2,sp,tab);
+        sx2=LLMulMod(c,sp,x2,sp,tab);
+        for (k=1;k<(1<<(w-1));k++)
+        {
+            LCopy(tab+k*sn,stab[k-1],tab+(k-1)*sn);
+            stab[k]=LLMulMod(c,stab[k-1],tab+k*sn,sx2,x2);
+        }
+    }
+
+    flag=0;
+    sr=1;
+    r[0]=1;
+    --i;
+    while (i>=0)
+    {
+        if (LBit(e,i)==0)
+        {   // bit nul hors fentre : un carr
+            if (flag!=0) sr=LLMulMod(c,sr,r,sr,r);
+            --i;
+            continue;
+        }
+        // fentre [l..i] de au plus w bits se terminant par un 1
+        l= i-w+1 < 0 ? 0 : i-w+1;
+        while (LBit(e,l)==0) ++l;
+        val=0;
+        for (k=i;k>=l;--k) val=(val<<1)|LBit(e,k);
+        if (flag!=0)
+        {
+            for (k=i;k>=l;--k) sr=LLMulMod(c,sr,r,sr,r);
+            sr=LLMulMod(c,sr,r,stab[val>>1],tab+(val>>1)*sn);
+        }
+        else
+        {
+            LCopy(r,stab[val>>1],tab+(val>>1)*sn);
+            sr=stab[val>>1];
+            flag=1;
+        }
+        i=l-1;
+    }
+    return sr;
+}
+
+/////////////////////////////////////////////////////////
+// exponentiation dans le domaine de Montgomery
+// R = B^sn, un nombre a est reprsent par a.R mod n sur sn chiffres
+// exactement (chiffres de poids fort ventuellement nuls).
+// Le produit de Montgomery a.b.R^-1 mod n entrelace multiplication et
+// rduction (mthode CIOS) : ni division, ni normalisation du modulo.
+// Le modulo n doit tre impair ; n' et R^2 mod n sont dans le contexte.
+/////////////////////////////////////////////////////////
+
+// soustraction sur "s" chiffres : a = a - b
+// rend la retenue (1 si a < b)
+static mot LSubN(int s, mot*a, mot*b)
+{
+    int i;
+    mot t;
+    mot carry;
+    carry=0;
+    for (i=0;i<s;i++)
+    {
+        t=a[i]-carry;
+        carry=(t>a[i]);
+        carry+=(t<b[i]);
+        a[i]=t-b[i];
+    }
+    return carry;
+}
+
+// calcule -n^-1 mod B par la mthode de Newton
+// chaque itration double le nombre de bits justes
+// (n0 impair est son propre inverse modulo 8)
+static mot MontN0(mot n0)
+{
+    mot x;
+    int i;
+    x=n0;
+    for (i=3;i<LIMB_BITS;i<<=1)
+    {
+        x=(dmot)x*(mot)(2-(dmot)n0*x);
+    }
+    return -x;
+}
+
+// produit de Montgomery r = a.b.R^-1 mod n
+// "a" et "b" sont sur sn chiffres et infrieurs  n
+// "r" peut tre confondu avec "a" ou "b"
+void LLMontMul(ctx_mod*c, mot*r, mot*a, mot*b)
+{
+    int i,j;
+    int sn;
+    mot*n;
+    mot*t;
+    mot np;
+    mot m;
+    mot carry;
+    dmot s;
+
+    if (c->mf!=NULL)
+    {
+        c->mf(r,a,b,c->n,c->np);
+        return;
+    }
+    sn=c->sn;
+    n=c->n;
+    t=c->t;
+    np=c->np;
+    for (j=0;j<sn+2;j++) t[j]=0;
+    for (i=0;i<sn;i++)
+    {
+        // t = t + a.b[i]
+        carry=LMulAdd(t,t,a,sn,b[i],0);
+        s=(dmot)t[sn]+carry;
+        t[sn]=s;
+        t[sn+1]=s>>LIMB_BITS;
+        // t = (t + m.n) / B, m choisi pour annuler le chiffre de poids faible
+        m=(dmot)t[0]*np;
+        carry=0;
+        SMul_a_a(m,n[0],t[0],&carry);
+        carry=LMulAdd(t,t+1,n+1,sn-1,m,carry);
+        s=(dmot)t[sn]+carry;
+        t[sn-1]=s;
+        t[sn]=t[sn+1]+(mot)(s>>LIMB_BITS);
+    }
+    // t < 2n : au plus une soustraction finale
+    if ( (t[sn]!=0) || (LCmp(sn,t,sn,n)>=0) )
+    {
+        LSubN(sn,t,n);
+    }
+    LCopy(r,sn,t);
+}
+
+/////////////////////////////////////////////////////////
+// produits de Montgomery  taille fixe
+// FIXE_DEF(bits) engendre LMontMul<bits>, le produit de LLMontMul pour
+// un modulo de exactement bits/LIMB_BITS chiffres. Toutes les bornes de
+// boucle sont des constantes, la zone de travail est sur la pile et la
+// soustraction finale est sans branchement : le compilateur peut
+// drouler les boucles internes. CtxInit choisit la version de la taille
+// du modulo quand elle existe (256, 1024, 2048, 3072 et 4096 bits).
+// A ces tailles elle remplace aussi le noyau LMulAdd, donc MULX/ADX ;
+// le banc mesure aussi le produit de taille variable (LLExpModMont_var)
+// et, sans la version fixe, le noyau C (LLExpModMont_prive_c).
+/////////////////////////////////////////////////////////
+
+#if defined(__GNUC__) && !defined(__clang__)
+#define FIXE_DEROULE _Pragma("GCC unroll 8")
+#else
+#define FIXE_DEROULE
+#endif
+
+#define FIXE_DEF(bits)                                                    \
+static void LMontMul##bits(mot*r, mot*a, mot*b, mot*n, mot np)            \
+{                                                                         \
+    enum { S=(bits)/LIMB_BITS };                                          \
+    mot t[S+2];                                                           \
+    mot u[S];                                                             \
+    mot m, carry, borrow, msk, v;                                         \
+    dmot s;                                                               \
+    int i, j;                                                             \
+    for (j=0;j<S+2;j++) t[j]=0;                                           \
+    for (i=0;i<S;i++)                                                     \
+    {                                                                     \
+        carry=0;                                                          \
+        FIXE_DEROULE                                                      \
+        for (j=0;j<S;j++) t[j]=SMul_a_a(a[j],b[i],t[j],&carry);           \
+        s=(dmot)t[S]+carry;                                               \
+        t[S]=s;                                                           \
+        t[S+1]=s>>LIMB_BITS;                                              \
+        m=(dmot)t[0]*np;                                                  \
+        carry=0;                                                          \
+        SMul_a_a(m,n[0],t[0],&carry);                                     \
+        FIXE_DEROULE                                                      \
+        for (j=1;j<S;j++) t[j-1]=SMul_a_a(m,n[j],t[j],&carry);            \
+        s=(dmot)t[S]+carry;                                               \
+        t[S-1]=s;                                                         \
+        t[S]=t[S+1]+(mot)(s>>LIMB_BITS);                                  \
+    }                                                                     \
+    /* u = t - n ; r = t si la soustraction dborde, u sinon */           \
+    borrow=0;                                                             \
+    FIXE_DEROULE                                                          \
+    for (j=0;j<S;j++)                                                     \
+    {                                                                     \
+        v=t[j]-borrow;                                                    \
+        borrow=(v>t[j]);                                                  \
+        borrow+=(v<n[j]);                                                 \
+        u[j]=v-n[j];                                                      \
+    }                                                                     \
+    msk=-(mot)(borrow>t[S]);                                              \
+    FIXE_DEROULE                                                          \
+    for (j=0;j<S;j++) r[j]=(t[j]&msk)|(u[j]&~msk);                        \
+}
+
+FIXE_DEF(256)
+FIXE_DEF(1024)
+FIXE_DEF(2048)
+FIXE_DEF(3072)
+FIXE_DEF(4096)
+
+// produit de taille fixe pour un modulo de "sn" chiffres, ou NULL
+static mont_fixe MontFixe(int sn)
+{
+    switch (sn*LIMB_BITS)
+    {
+    case 256:  return LMontMul256;
+    case 1024: return LMontMul1024;
+    case 2048: return LMontMul2048;
+    case 3072: return LMontMul3072;
+    case 4096: return LMontMul4096;
+    }
+    return NULL;
+}
+
+// Elvation de x  la puissance e, modulo n rsultat dans r (sn chiffres)
+// "x" de taille au plus 2sn ;
+// mme rsultat que LLExpMod, chaque carr et chaque produit tant
+// un produit de Montgomery ; rend la taille du rsultat.
+// Si n est pair, on se replie sur LLExpModFen.
+int LLExpModMont(ctx_mod*c, mot*r, int sx, mot*x, int se, mot*e)
+{
+    int sr;             // taille du rsultat
+    int flag;           // mis  1 ds que le rsultat est diffrent de 1
+    mot t;              // chiffre courant de l'exposant
+    mot msk;            // masque du bit de l'exposant
+    int sn;
+    int sp;
+    mot*xm;             // x.R mod n
+    int i;
+
+    if (c->np==0) return LLExpModFen(c,r,sx,x,se,e);
+    sn=c->sn;
+    // passage de x dans le domaine de Montgomery
+    xm=c->a;
+    LCopy(xm,sx,x);
+    sp=sx;
+    ModuloCtx(c,&sp,xm);
+    for (i=sp;i<sn;i++) xm[i]=0;
+    LLMontMul(c,xm,xm,c->r2);
+
+    flag=0;
+    while(se!=0)
+    {
+        t=e[--se];
+        for (msk=MOT_HAUT;msk!=0;msk>>=1)
+        {
+            if (flag!=0)
+            {
+                LLMontMul(c,r,r,r);
+            }
+            if ((t&msk)!=0)
+            {
+                if (flag!=0) LLMontMul(c,r,r,xm);
+                else LCopy(r,sn,xm);
+                flag=1;
+            }
+        }
+    }
+    if (flag==0)
+    {   // exposant nul
+        r[0]=1;
+        return 1;
+    }
+    // retour au domaine usuel : r = r.1.R^-1
+    LLMontMul(c,r,r,c->u);
+    sr=sn;
+    while ( (sr>0) && (r[sr-1]==0) ) sr--;
+    return sr;
+}
+
+// Elvation de x  la puissance e, modulo n rsultat dans r (sn chiffres)
+// selon la mthode de rduction du contexte : LLExpModMont en
+// RED_MONTGOMERY, LLExpModFen avec division ou Barrett sinon
+int LLExpModCtx(ctx_mod*c, mot*r, int sx, mot*x, int se, mot*e)
+{
+    if (c->red==RED_MONTGOMERY) return LLExpModMont(c,r,sx,x,se,e);
+    return LLExpModFen(c,r,sx,x,se,e);
+}
+
+/////////////////////////////////////////////////////////
+// exposants publics usuels
+// e = 3 et e = 65537 sont de la forme 2^k+1 : k carrs et un produit.
+// En Montgomery, a = x.R puis k carrs donnent x^(2^k).R, et le
+// produit final par x (hors domaine) donne directement x^(2^k+1) :
+// k+2 produits en tout, sans retour explicite au domaine usuel.
+/////////////////////////////////////////////////////////
+
+// r = x^(2^k+1) mod n (sn chiffres), "x" de taille au plus 2sn
+// rend la taille du rsultat
+static int ExpCarres(ctx_mod*c, mot*r, int sx, mot*x, int k)
+{
+    int sn;
+    int sp;
+    int i;
+    mot*xr;             // x mod n sur sn chiffres
+
+    sn=c->sn;
+    xr=c->a;
+    LCopy(xr,sx,x);
+    sp=sx;
+    ModuloCtx(c,&sp,xr);
+    for (i=sp;i<sn;i++) xr[i]=0;
+    LLMontMul(c,r,xr,c->r2);
+    for (i=0;i<k;i++) LLMontMul(c,r,r,r);
+    LLMontMul(c,r,r,xr);
+    sp=sn;
+    while ( (sp>0) && (r[sp-1]==0) ) sp--;
+    return sp;
+}
+
+// rend k si e = 2^k+1 avec k = 1 (e = 3) ou k = 16 (e = 65537), 0 sinon
+static int ExpChaine(int se, mot*e)
+{
+    int nbits;
+    int i;
+    nbits=LBits(se,e);
+    if ( (nbits!=2) && (nbits!=17) ) return 0;
+    for (i=1;i<nbits-1;i++) if (LBit(e,i)) return 0;
+    return LBit(e,0) ? nbits-1 : 0;
+}
+
+// opration publique r = x^e mod n (chiffrement, vrification)
+// chane fixe pour e = 3 et e = 65537, LLExpModCtx sinon ou si n est pair
+// "x" de taille au plus sn ; rend la taille du rsultat
+int LLExpModPub(ctx_mod*c, mot*r, int sx, mot*x, int se, mot*e)
+{
+    int k;
+    k=ExpChaine(se,e);
+    if ( (k==0) || (c->np==0) ) return LLExpModCtx(c,r,sx,x,se,e);
+    return ExpCarres(c,r,sx,x,k);
+}
+
+// vrification d'un lot de "nb" signatures s[i] sur les messages m[i]
+// sous la mme cl publique (n du contexte, e) : ok[i] = (s[i]^e mod n == m[i])
+// le contexte et la chane d'exposant servent  tout le lot
+// rend le nombre de signatures valides
+int LotVerifie(ctx_mod*c, int se, mot*e, int nb, int*ss, mot**s,
+               int*sm, mot**m, int*ok)
+{
+    mot r[MAX];
+    int sr;
+    int k;
+    int i;
+    int nok;
+
+    k=ExpChaine(se,e);
+    if (c->np==0) k=0;
+    nok=0;
+    for (i=0;i<nb;i++)
+    {
+        if (k) sr=ExpCarres(c,r,ss[i],s[i],k);
+        else sr=LLExpModCtx(c,r,ss[i],s[i],se,e);
+        ok[i]=(LCmp(sr,r,sm[i],m[i])==0);
+        nok+=ok[i];
+    }
+    return nok;
+}
+
+/////////////////////////////////////////////////////////
+// exponentiation simultane
+// r = x^a.y^b mod n (astuce de Shamir) : les deux exposants sont lus
+// ensemble par tranches de 2 bits, avec une seule suite de carrs ; la
+// table x^i.y^j (0 <= i,j < 4) vite un produit par base et par
+// tranche. Pour k bases, mthode des fentres entrelaces : chaque
+// exposant a sa table de puissances impaires et ses fentres glissantes,
+// les carrs sont communs, chaque fentre cote un produit  son bit de
+// fin. Environ deux fois moins de carrs que des exponentiations
+// spares. Calcul dans le domaine de Montgomery ; si n est pair, on se
+// replie sur LLExpModFen et LLMulMod.
+/////////////////////////////////////////////////////////
+
+#define SHAMIR_FEN 2            // bits lus par exposant et par tranche
+#define ENTRELACE_FEN_MAX 5     // fentre maxi des fentres entrelaces
+
+// bit "i" de l'exposant "e" de taille "se", 0 au-del
+static int LBitS(int se, mot*e, int i)
+{
+    return i<se*LIMB_BITS ? LBit(e,i) : 0;
+}
+
+// r = x.R mod n sur sn chiffres, "x" de taille au plus 2sn
+static void VersMont(ctx_mod*c, mot*r, int sx, mot*x)
+{
+    int sp;
+    int i;
+    LCopy(c->a,sx,x);
+    sp=sx;
+    ModuloCtx(c,&sp,c->a);
+    for (i=sp;i<c->sn;i++) c->a[i]=0;
+    LLMontMul(c,r,c->a,c->r2);
+}
+
+// r = produit des x[i]^e[i] mod n par exponentiations spares (n pair)
+static int ExpProduit(ctx_mod*c, mot*r, int k, int*sx, mot**x, int*se, mot**e)
+{
+    mot t[MAX];
+    int st;
+    int sr;
+    int i;
+    sr=1;
+    r[0]=1;
+    for (i=0;i<k;i++)
+    {
+        st=LLExpModFen(c,t,sx[i],x[i],se[i],e[i]);
+        sr=LLMulMod(c,sr,r,st,t);
+    }
+    return sr;
+}
+
+// Elvation simultane r = x^a.y^b mod n (sn chiffres)
+// "x" et "y" de taille au plus 2sn ; rend la taille du rsultat
+int LLExpMod2(ctx_mod*c, mot*r, int sx, mot*x, int sa, mot*a,
+              int sy, mot*y, int sb, mot*b)
+{
+    int sn;
+    int i, j;
+    int pos;
+    int flag;
+    int sr;
+    mot*tab;                // tab[4i+j] = x^i.y^j.R mod n, sn chiffres chacun
+    int  tx[2]; mot*px[2];
+    int  te[2]; mot*pe[2];
+
+    if (c->np==0)
+    {
+        tx[0]=sx; px[0]=x; te[0]=sa; pe[0]=a;
+        tx[1]=sy; px[1]=y; te[1]=sb; pe[1]=b;
+        return ExpProduit(c,r,2,tx,px,te,pe);
+    }
+    sn=c->sn;
+    tab=c->tab;             // 16 sn chiffres <= (2^(FEN_MAX-1)+1) sn
+#define T(i,j) (tab+(4*(i)+(j))*sn)
+    VersMont(c,T(1,0),sx,x);
+    VersMont(c,T(0,1),sy,y);
+    for (i=2;i<4;i++)
+    {
+        LLMontMul(c,T(i,0),T(i-1,0),T(1,0));
+        LLMontMul(c,T(0,i),T(0,i-1),T(0,1));
+    }
+    for (i=1;i<4;i++)
+    {
+        for (j=1;j<4;j++) LLMontMul(c,T(i,j),T(i,0),T(0,j));
+    }
+
+    flag=0;
+    pos=LBits(sa,a);
+    if (LBits(sb,b)>pos) pos=LBits(sb,b);
+    pos=(pos+SHAMIR_FEN-1)/SHAMIR_FEN*SHAMIR_FEN;
+    for (pos-=SHAMIR_FEN;pos>=0;pos-=SHAMIR_FEN)
+    {
+        i=2*LBitS(sa,a,pos+1)+LBitS(sa,a,pos);
+        j=2*LBitS(sb,b,pos+1)+LBitS(sb,b,pos);
+        if (flag!=0)
+        {
+            LLMontMul(c,r,r,r);
+            LLMontMul(c,r,r,r);
+        }
+        if ( (i|j)!=0 )
+        {
+            if (flag!=0) LLMontMul(c,r,r,T(i,j));
+            else LCopy(r,sn,T(i,j));
+            flag=1;
+        }
+    }
+#undef T
+    if (flag==0)
+    {   // exposants nuls
+        r[0]=1;
+        return 1;
+    }
+    LLMontMul(c,r,r,c->u);
+    sr=sn;
+    while ( (sr>0) && (r[sr-1]==0) ) sr--;
+    return sr;
+}
+
+// prochaine fentre de l'exposant "e" au plus haut  partir du bit "p" :
+// au plus "w" bits, commenant et finissant par un 1 ; crit son bit de
+// fin dans *fin (-1 s'il n'y a plus de bit  1) et sa valeur dans *val
+static void FenSuivante(int se, mot*e, int p, int w, int*fin, int*val)
+{
+    int h, l;
+    int i;
+    while ( (p>=0) && !LBitS(se,e,p) ) p--;
+    *fin=p;
+    if (p<0) return;
+    h=p;
+    l= h-w+1>0 ? h-w+1 : 0;
+    while (!LBitS(se,e,l)) l++;
+    *val=0;
+    for (i=h;i>=l;i--) *val=2*(*val)+LBitS(se,e,i);
+    *fin=l;
+}
+
+// Elvation simultane r = produit des x[i]^e[i] mod n, i < k (sn chiffres)
+// "x[i]" de taille au plus 2sn ; rend la taille du rsultat, ou -1 si
+// l'allocation des tables choue
+int LLExpModMultiBase(ctx_mod*c, mot*r, int k, int*sx, mot**x, int*se, mot**e)
+{
+    int sn;
+    int nbits;
+    int w;
+    int nt;             // puissances impaires par base
+    int i, j;
+    int pos;
+    int flag;
+    int sr;
+    mot*tab;            // tab[i.nt+j] = x[i]^(2j+1).R mod n
+    int*fin;            // bit de fin de la fentre en cours de chaque base
+    int*val;            // valeur de cette fentre
+
+    if (c->np==0) return ExpProduit(c,r,k,sx,x,se,e);
+    sn=c->sn;
+    nbits=0;
+    for (i=0;i<k;i++) if (LBits(se[i],e[i])>nbits) nbits=LBits(se[i],e[i]);
+    w=FenTaille(nbits);
+    if (w>ENTRELACE_FEN_MAX) w=ENTRELACE_FEN_MAX;
+    nt=1<<(w-1);
+    // les entiers en tte de zone, pour leur alignement
+    fin=malloc(2*k*sizeof(int)+((size_t)k*nt+1)*sn*sizeof(mot));
+    if (fin==NULL) return -1;
+    val=fin+k;
+    tab=(mot*)(val+k);
+    // tables des puissances impaires, x[i]^2 dans la dernire zone
+    for (i=0;i<k;i++)
+    {
+        VersMont(c,tab+i*nt*sn,sx[i],x[i]);
+        if (nt>1) LLMontMul(c,tab+k*nt*sn,tab+i*nt*sn,tab+i*nt*sn);
+        for (j=1;j<nt;j++)
+        {
+            LLMontMul(c,tab+(i*nt+j)*sn,tab+(i*nt+j-1)*sn,tab+k*nt*sn);
+        }
+        FenSuivante(se[i],e[i],nbits-1,w,fin+i,val+i);
+    }
+
+    flag=0;
+    for (pos=nbits-1;pos>=0;pos--)
+    {
+        if (flag!=0) LLMontMul(c,r,r,r);
+        for (i=0;i<k;i++)
+        {
+            if (fin[i]!=pos) continue;
+            if (flag!=0) LLMontMul(c,r,r,tab+(i*nt+(val[i]>>1))*sn);
+            else LCopy(r,sn,tab+(i*nt+(val[i]>>1))*sn);
+            flag=1;
+            FenSuivante(se[i],e[i],pos-1,w,fin+i,val+i);
+        }
+    }
+    free(fin);
+    if (flag==0)
+    {
+        r[0]=1;
+        return 1;
+    }
+    LLMontMul(c,r,r,c->u);
+    sr=sn;
+    while ( (sr>0) && (r[sr-1]==0) ) sr--;
+    return sr;
+}
+
+/////////////////////////////////////////////////////////
+// exponentiation multi-messages (SIMD)
+// Plusieurs messages sous la mme cl sont levs  la mme puissance
+// en parallle, un message par voie d'un registre vectoriel : 4 voies
+// en AVX2, 8 en AVX-512. Dans chaque voie de 64 bits, un chiffre de
+// 32 bits ; a.b + t + retenue tient donc dans la voie, et chaque
+// produit de Montgomery suit exactement LLMontMul, voie par voie.
+// Les valeurs sont entrelaces : le chiffre i du message l est en
+// x[i*voies+l]. Exponentiation par fentre fixe de 4 bits, la mme
+// suite d'oprations servant  tous les messages.
+// Le noyau est choisi  l'excution selon le processeur ; sans AVX2,
+// ou si n est pair, chaque message passe par LLExpModMont.
+/////////////////////////////////////////////////////////
+
+#define MB_FEN 4                // largeur de la fentre fixe
+
+// produit de Montgomery sur "voies" messages entrelacs, chiffres de 32 bits
+// r = a.b.R^-1 mod n ; "r" peut tre confondu avec "a" ou "b"
+// "t" : zone de travail de (s+2)*voies mots de 64 bits
+typedef void (*mb_mul)(uint64_t*r, const uint64_t*a, const uint64_t*b,
+                       const uint32_t*n, uint32_t np, int s, uint64_t*t);
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static void MbMul4(uint64_t*r, const uint64_t*a, const uint64_t*b,
+                   const uint32_t*n, uint32_t np, int s, uint64_t*t)
+{
+    const __m256i msk=_mm256_set1_epi64x(0xffffffff);
+    __m256i bi, m, p, c, d, neg;
+    int i,j;
+
+#define LD(x)    _mm256_loadu_si256((const __m256i*)(x))
+#define ST(x,v)  _mm256_storeu_si256((__m256i*)(x),v)
+    for (j=0;j<4*(s+2);j++) t[j]=0;
+    for (i=0;i<s;i++)
+    {
+        // t = t + a.b[i]
+        bi=LD(b+4*i);
+        c=_mm256_setzero_si256();
+        for (j=0;j<s;j++)
+        {
+            p=_mm256_mul_epu32(LD(a+4*j),bi);
+            p=_mm256_add_epi64(_mm256_add_epi64(p,LD(t+4*j)),c);
+            ST(t+4*j,_mm256_and_si256(p,msk));
+            c=_mm256_srli_epi64(p,32);
+        }
+        p=_mm256_add_epi64(LD(t+4*s),c);
+        ST(t+4*s,_mm256_and_si256(p,msk));
+        ST(t+4*(s+1),_mm256_srli_epi64(p,32));
+        // t = (t + m.n) / 2^32
+        m=_mm256_and_si256(_mm256_mul_epu32(LD(t),_mm256_set1_epi64x(np)),msk);
+        p=_mm256_add_epi64(_mm256_mul_epu32(m,_mm256_set1_epi64x(n[0])),LD(t));
+        c=_mm256_srli_epi64(p,32);
+        for (j=1;j<s;j++)
+        {
+            p=_mm256_mul_epu32(m,_mm256_set1_epi64x(n[j]));
+            p=_mm256_add_epi64(_mm256_add_epi64(p,LD(t+4*j)),c);
+            ST(t+4*(j-1),_mm256_and_si256(p,msk));
+            c=_mm256_srli_epi64(p,32);
+        }
+        p=_mm256_add_epi64(LD(t+4*s),c);
+        ST(t+4*(s-1),_mm256_and_si256(p,msk));
+        ST(t+4*s,_mm256_add_epi64(LD(t+4*(s+1)),_mm256_srli_epi64(p,32)));
+    }
+    // r = t - n, puis t l o la soustraction dborde (t < n)
+    c=_mm256_setzero_si256();
+    for (j=0;j<s;j++)
+    {
+        d=_mm256_sub_epi64(_mm256_sub_epi64(LD(t+4*j),_mm256_set1_epi64x(n[j])),c);
+        ST(r+4*j,_mm256_and_si256(d,msk));
+        c=_mm256_srli_epi64(d,63);
+    }
+    d=_mm256_sub_epi64(LD(t+4*s),c);
+    neg=_mm256_cmpgt_epi64(_mm256_setzero_si256(),d);
+    for (j=0;j<s;j++)
+    {
+        ST(r+4*j,_mm256_blendv_epi8(LD(r+4*j),LD(t+4*j),neg));
+    }
+#undef LD
+#undef ST
+}
+
+__attribute__((target("avx512f")))
+static void MbMul8(uint64_t*r, const uint64_t*a, const uint64_t*b,
+                   const uint32_t*n, uint32_t np, int s, uint64_t*t)
+{
+    const __m512i msk=_mm512_set1_epi64(0xffffffff);
+    __m512i bi, m, p, c, d;
+    __mmask8 neg;
+    int i,j;
+
+#define LD(x)    _mm512_loadu_si512((const void*)(x))
+#define ST(x,v)  _mm512_storeu_si512((void*)(x),v)
+    for (j=0;j<8*(s+2);j++) t[j]=0;
+    for (i=0;i<s;i++)
+    {
+        bi=LD(b+8*i);
+        c=_mm512_setzero_si512();
+        for (j=0;j<s;j++)
+        {
+            p=_mm512_mul_epu32(LD(a+8*j),bi);
+            p=_mm512_add_epi64(_mm512_add_epi64(p,LD(t+8*j)),c);
+            ST(t+8*j,_mm512_and_si512(p,msk));
+            c=_mm512_srli_epi64(p,32);
+        }
+        p=_mm512_add_epi64(LD(t+8*s),c);
+        ST(t+8*s,_mm512_and_si512(p,msk));
+        ST(t+8*(s+1),_mm512_srli_epi64(p,32));
+        m=_mm512_and_si512(_mm512_mul_epu32(LD(t),_mm512_set1_epi64(np)),msk);
+        p=_mm512_add_epi64(_mm512_mul_epu32(m,_mm512_set1_epi64(n[0])),LD(t));
+        c=_mm512_srli_epi64(p,32);
+        for (j=1;j<s;j++)
+        {
+            p=_mm512_mul_epu32(m,_mm512_set1_epi64(n[j]));
+            p=_mm512_add_epi64(_mm512_add_epi64(p,LD(t+8*j)),c);
+            ST(t+8*(j-1),_mm512_and_si512(p,msk));
+            c=_mm512_srli_epi64(p,32);
+        }
+        p=_mm512_add_epi64(LD(t+8*s),c);
+        ST(t+8*(s-1),_mm512_and_si512(p,msk));
+        ST(t+8*s,_mm512_add_epi64(LD(t+8*(s+1)),_mm512_srli_epi64(p,32)));
+    }
+    c=_mm512_setzero_si512();
+    for (j=0;j<s;j++)
+    {
+        d=_mm512_sub_epi64(_mm512_sub_epi64(LD(t+8*j),_mm512_set1_epi64(n[j])),c);
+        ST(r+8*j,_mm512_and_si512(d,msk));
+        c=_mm512_srli_epi64(d,63);
+    }
+    d=_mm512_sub_epi64(LD(t+8*s),c);
+    neg=_mm512_cmplt_epi64_mask(d,_mm512_setzero_si512());
+    for (j=0;j<s;j++)
+    {
+        ST(r+8*j,_mm512_mask_blend_epi64(neg,LD(r+8*j),LD(t+8*j)));
+    }
+#undef LD
+#undef ST
+}
+#endif
+
+// noyau pour "voies" voies, ou le plus large disponible si voies vaut 0
+// rend le nombre de voies et affecte le noyau  *f ; rend 0 si aucun
+// noyau SIMD ne convient
+static int MbNoyau(int voies, mb_mul*f)
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if ( ((voies==0) || (voies==8)) && __builtin_cpu_supports("avx512f") )
+    {
+        *f=MbMul8;
+        return 8;
+    }
+    if ( ((voies==0) || (voies==4)) && __builtin_cpu_supports("avx2") )
+    {
+        *f=MbMul4;
+        return 4;
+    }
+#endif
+    (void)voies;
+    *f=NULL;
+    return 0;
+}
+
+// "x" (taille "sx") vers "d", "s32" chiffres de 32 bits
+static void L32De(uint32_t*d, int s32, int sx, mot*x)
+{
+    int i;
+    for (i=0;i<s32;i++) d[i]=0;
+    for (i=0;i<sx;i++)
+    {
+#if LIMB_BITS==64
+        d[2*i]=(uint32_t)x[i];
+        d[2*i+1]=(uint32_t)(x[i]>>32);
+#else
+        d[i/(32/LIMB_BITS)]|=(uint32_t)x[i]<<(LIMB_BITS*(i%(32/LIMB_BITS)));
+#endif
+    }
+}
+
+// "d" (chiffres de 32 bits) vers "x" sur "sn" chiffres ; rend la taille de x
+static int L32Vers(mot*x, int sn, uint32_t*d)
+{
+    int i;
+    for (i=0;i<sn;i++)
+    {
+#if LIMB_BITS==64
+        x[i]=d[2*i]|((mot)d[2*i+1]<<32);
+#else
+        x[i]=(mot)(d[i/(32/LIMB_BITS)]>>(LIMB_BITS*(i%(32/LIMB_BITS))));
+#endif
+    }
+    while ( (sn>0) && (x[sn-1]==0) ) sn--;
+    return sn;
+}
+
+// d = x.B^k mod n sur "s" chiffres de 32 bits, "x" de taille au plus sn
+static void MbVersMont(ctx_mod*c, int k, int s, uint32_t*d, int sx, mot*x)
+{
+    mot u[2*MAX+8];
+    int su;
+    int i;
+    for (i=0;i<k;i++) u[i]=0;
+    LCopy(u+k,sx,x);
+    su=k+sx;
+    while ( (su>0) && (u[su-1]==0) ) su--;
+    ModuloCtx(c,&su,u);
+    L32De(d,s,su,u);
+}
+
+// "nb" messages (au plus "voies") levs  la puissance e avec le noyau "f"
+// rend 0, ou -1 si la mmoire manque
+static int MbExp(ctx_mod*c, mb_mul f, int voies, int nb, mot**r, int*sr,
+                 int*sx, mot**x, int se, mot*e)
+{
+    uint32_t n32[MAX_BITS/32+1];
+    uint32_t d32[MAX_BITS/32+1];
+    mot un=1;
+    int s;              // nombre de chiffres de 32 bits
+    int k;              // R = 2^(32s) = B^k
+    uint32_t np;
+    uint64_t*z;
+    uint64_t*tab;       // x^0 ... x^(2^MB_FEN-1), domaine de Montgomery
+    uint64_t*acc;
+    uint64_t*t;
+    int i, j, l;
+    int nbits;
+    int fen;
+    int flag;
+
+    s=(c->sn*LIMB_BITS+31)/32;
+    k=s*32/LIMB_BITS;
+    L32De(n32,s,c->sn,c->n);
+    // -n^-1 mod 2^32 par la mthode de Newton
+    np=n32[0];
+    for (i=0;i<4;i++) np*=2-n32[0]*np;
+    np=-np;
+    z=malloc(((1<<MB_FEN)+1)*s*voies*sizeof(uint64_t)+(s+2)*voies*sizeof(uint64_t));
+    if (z==NULL) return -1;
+    tab=z;
+    acc=tab+(1<<MB_FEN)*s*voies;
+    t=acc+s*voies;
+
+    // tab[0] = R mod n dans toutes les voies
+    MbVersMont(c,k,s,d32,1,&un);
+    for (i=0;i<s;i++) for (l=0;l<voies;l++) tab[i*voies+l]=d32[i];
+    // tab[1] = x.R mod n, voie par voie (message 0 dans les voies inutilises)
+    for (l=0;l<voies;l++)
+    {
+        j= l<nb ? l : 0;
+        MbVersMont(c,k,s,d32,sx[j],x[j]);
+        for (i=0;i<s;i++) tab[(s+i)*voies+l]=d32[i];
+    }
+    for (i=2;i<(1<<MB_FEN);i++)
+    {
+        f(tab+i*s*voies,tab+(i-1)*s*voies,tab+s*voies,n32,np,s,t);
+    }
+
+    flag=0;
+    nbits=LBits(se,e);
+    for (i=(nbits+MB_FEN-1)/MB_FEN-1;i>=0;i--)
+    {
+        fen=0;
+        for (j=MB_FEN-1;j>=0;j--)
+        {
+            fen<<=1;
+            if (i*MB_FEN+j<nbits) fen|=LBit(e,i*MB_FEN+j);
+        }
+        if (flag)
+        {
+            for (j=0;j<MB_FEN;j++) f(acc,acc,acc,n32,np,s,t);
+            if (fen) f(acc,acc,tab+fen*s*voies,n32,np,s,t);
+        }
+        else
+        {
+            for (j=0;j<s*voies;j++) acc[j]=tab[fen*s*voies+j];
+            flag=1;
+        }
+    }
+    if (!flag)
+    {   // exposant nul
+        for (j=0;j<s*voies;j++) acc[j]=tab[j];
+    }
+    // retour au domaine usuel : produit par 1
+    for (j=0;j<s*voies;j++) tab[j]= j<voies;
+    f(acc,acc,tab,n32,np,s,t);
+    for (l=0;l<nb;l++)
+    {
+        for (i=0;i<s;i++) d32[i]=(uint32_t)acc[i*voies+l];
+        sr[l]=L32Vers(r[l],c->sn,d32);
+    }
+    free(z);
+    return 0;
+}
+
+// Elvation de "nb" messages x[i] (tailles sx[i], au plus sn)  la mme
+// puissance e modulo n ; rsultats dans r[i] (sn chiffres), tailles dans sr[i]
+// "voies" : 4 (AVX2), 8 (AVX-512), 1 (LLExpModMont message par message)
+// ou 0 pour le noyau le plus large disponible
+// rend 0, ou -1 si le noyau demand n'est pas disponible
+int LLExpModMulti(ctx_mod*c, int voies, int nb, mot**r, int*sr,
+                  int*sx, mot**x, int se, mot*e)
+{
+    mb_mul f;
+    int v;
+    int i;
+
+    v= voies==1 ? 0 : MbNoyau(voies,&f);
+    if ( (voies>1) && (v==0) ) return -1;
+    if ( (v==0) || (c->np==0) )
+    {
+        for (i=0;i<nb;i++) sr[i]=LLExpModMont(c,r[i],sx[i],x[i],se,e);
+        return 0;
+    }
+    for (i=0;i<nb;i+=v)
+    {
+        if (MbExp(c,f,v,nb-i<v?nb-i:v,r+i,sr+i,sx+i,x+i,se,e)!=0) return -1;
+    }
+    return 0;
+}
+
+/////////////////////////////////////////////////////////
+// fork-join lger
+// Un thread auxiliaire permanent excute une fonction  la demande.
+// L'tat est un entier atomique : l'attente commence par une boucle
+// active courte (AIDE_BOUCLE tours) puis se bloque sur une variable de
+// condition. Lancer et attendre ne cotent qu'un change d'tat et un
+// signal, sans cration de thread.
+/////////////////////////////////////////////////////////
+
+#define AIDE_BOUCLE 20000
+
+#define AIDE_LIBRE   0
+#define AIDE_TRAVAIL 1      // fonction  excuter
+#define AIDE_FINI    2      // fonction excute
+#define AIDE_ARRET   3
+
+typedef struct
+{
+    pthread_t th;
+    pthread_mutex_t m;
+    pthread_cond_t cv;
+    _Atomic int etat;
+    void (*f)(void*);
+    void* arg;
+} aide_fj;
+
+// rveille un ventuel thread bloqu aprs un changement d'tat
+static void AideSignale(aide_fj*a)
+{
+    pthread_mutex_lock(&a->m);
+    pthread_cond_broadcast(&a->cv);
+    pthread_mutex_unlock(&a->m);
+}
+
+// change l'tat et rveille un ventuel thread bloqu
+static void AideEtat(aide_fj*a, int etat)
+{
+    atomic_store(&a->etat,etat);
+    AideSignale(a);
+}
+
+// attend que l'tat soit "e1" ou "e2" ; rend l'tat
+static int AideAttendEtat(aide_fj*a, int e1, int e2)
+{
+    int i;
+    int e;
+    for (i=0;i<AIDE_BOUCLE;i++)
+    {
+        e=atomic_load(&a->etat);
+        if ( (e==e1) || (e==e2) ) return e;
+    }
+    pthread_mutex_lock(&a->m);
+    for (;;)
+    {
+        e=atomic_load(&a->etat);
+        if ( (e==e1) || (e==e2) ) break;
+        pthread_cond_wait(&a->cv,&a->m);
+    }
+    pthread_mutex_unlock(&a->m);
+    return e;
+}
+
+static void* Aide(void*arg)
+{
+    aide_fj*a=arg;
+    int e;
+    while (AideAttendEtat(a,AIDE_TRAVAIL,AIDE_ARRET)==AIDE_TRAVAIL)
+    {
+        a->f(a->arg);
+        // TRAVAIL -> FINI seulement : un arrt demand pendant le travail
+        // n'est pas cras
+        e=AIDE_TRAVAIL;
+        if (!atomic_compare_exchange_strong(&a->etat,&e,AIDE_FINI)) break;
+        AideSignale(a);
+    }
+    return NULL;
+}
+
+// cration du thread auxiliaire ; rend 0 ou -1
+int AideCree(aide_fj*a)
+{
+    atomic_init(&a->etat,AIDE_LIBRE);
+    pthread_mutex_init(&a->m,NULL);
+    pthread_cond_init(&a->cv,NULL);
+    if (pthread_create(&a->th,NULL,Aide,a)!=0)
+    {
+        pthread_mutex_destroy(&a->m);
+        pthread_cond_destroy(&a->cv);
+        return -1;
+    }
+    return 0;
+}
+
+// arrt du thread auxiliaire ; si une fonction est en cours, elle se
+// termine avant l'arrt
+void AideDetruit(aide_fj*a)
+{
+    AideEtat(a,AIDE_ARRET);
+    pthread_join(a->th,NULL);
+    pthread_mutex_destroy(&a->m);
+    pthread_cond_destroy(&a->cv);
+}
+
+// fork : f(arg) est excute par le thread auxiliaire
+void AideLance(aide_fj*a, void (*f)(void*), void*arg)
+{
+    a->f=f;
+    a->arg=arg;
+    AideEtat(a,AIDE_TRAVAIL);
+}
+
+// join : attend la fin de la fonction lance
+void AideJoint(aide_fj*a)
+{
+    AideAttendEtat(a,AIDE_FINI,AIDE_FINI);
+    atomic_store(&a->etat,AIDE_LIBRE);
+}
+
+/////////////////////////////////////////////////////////
+// opration prive par le thorme des restes chinois
+// Deux exponentiations de taille moiti, modulo p et modulo q,
+// recombines par la formule de Garner :
+//   m1 = x^dP mod p, m2 = x^dQ mod q
+//   h  = qInv.(m1 - m2) mod p
+//   m  = m2 + h.q
+// p et q doivent avoir au moins deux chiffres (cf. Modulo).
+// Aprs CRTParallele, m2 est calcul par un thread auxiliaire pendant
+// que l'appelant calcule m1 : la latence d'une opration est  peu
+// prs celle d'une seule demi-exponentiation.
+/////////////////////////////////////////////////////////
+
+// cl prive sous forme CRT
+typedef struct
+{
+    ctx_mod cp;              // contexte modulo p
+    ctx_mod cq;              // contexte modulo q
+    int sdp; mot dp[MAX];    // d mod (p-1)
+    int sdq; mot dq[MAX];    // d mod (q-1)
+    int sqi; mot qi[MAX];    // q^-1 mod p
+    aide_fj* aide;           // thread auxiliaire, ou NULL
+} cle_crt;
+
+// demi-exponentiation confie au thread auxiliaire
+typedef struct
+{
+    ctx_mod* c;
+    mot* r;
+    int sx; mot* x;
+    int se; mot* e;
+    int sr;
+} demi_crt;
+
+static void DemiCRT(void*arg)
+{
+    demi_crt*m=arg;
+    m->sr=LLExpModMont(m->c,m->r,m->sx,m->x,m->se,m->e);
+}
+
+// paramtres des restes chinois dP = d mod (p-1), dQ = d mod (q-1) et
+// qInv = q^-1 mod p, sans contexte (ni entre dans le cache)
+// "dp", "dq" et "qi" de taille au moins MAX
+// rend 0, ou -1 si p ou q est hors limite ou si q n'est pas
+// inversible modulo p
+int CRTParametres(int sp, mot*p, int sq, mot*q, int sd, mot*d,
+                  int*psdp, mot*dp, int*psdq, mot*dq, int*psqi, mot*qi)
+{
+    int sm;  mot m[MAX];    // p-1, q-1
+    int st;  mot t[MAX];
+    mot un=1;
+
+    if ( (sp<2) || (sp>MAX) || (sq<2) || (sq>MAX) || (sd>MAX) ) return -1;
+    // dP = d mod (p-1)
+    sm=LSub(m,sp,p,1,&un);
+    st=sd; LCopy(t,sd,d);
+    Modulo(&st,t,sm,m);
+    *psdp=st; LCopy(dp,st,t);
+    // dQ = d mod (q-1)
+    sm=LSub(m,sq,q,1,&un);
+    st=sd; LCopy(t,sd,d);
+    Modulo(&st,t,sm,m);
+    *psdq=st; LCopy(dq,st,t);
+    // qInv = (q mod p)^-1 mod p
+    st=sq; LCopy(t,sq,q);
+    Modulo(&st,t,sp,p);
+    *psqi=LInvMod(qi,st,t,sp,p);
+    return *psqi<0 ? -1 : 0;
+}
+
+// contextes modulo p et q et paramtres des restes chinois
+// rend 0, ou -1 si l'un des contextes ne peut tre cr ou si q n'est
+// pas inversible modulo p
+int CRTPrepare(cle_crt*k, int sp, mot*p, int sq, mot*q, int sd, mot*d)
+{
+    k->aide=NULL;
+    if (CtxInit(&k->cp,sp,p)!=0) return -1;
+    if (CtxInit(&k->cq,sq,q)!=0)
+    {
+        CtxLibere(&k->cp);
+        return -1;
+    }
+    if (CRTParametres(sp,p,sq,q,sd,d,&k->sdp,k->dp,&k->sdq,k->dq,&k->sqi,k->qi)!=0)
+    {
+        CtxLibere(&k->cp);
+        CtxLibere(&k->cq);
+        return -1;
+    }
+    return 0;
+}
+
+// libration des contextes de la cl
+void CRTLibere(cle_crt*k)
+{
+    if (k->aide!=NULL)
+    {
+        AideDetruit(k->aide);
+        free(k->aide);
+        k->aide=NULL;
+    }
+    CtxLibere(&k->cp);
+    CtxLibere(&k->cq);
+}
+
+// mode basse latence : les deux demi-exponentiations de LLExpModCRT
+// sont faites en mme temps ; rend 0 ou -1
+// une cl en mode parallle ne sert qu' un seul appelant  la fois
+int CRTParallele(cle_crt*k)
+{
+    if (k->aide!=NULL) return 0;
+    k->aide=malloc(sizeof(aide_fj));
+    if (k->aide==NULL) return -1;
+    if (AideCree(k->aide)!=0)
+    {
+        free(k->aide);
+        k->aide=NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// opration prive r = x^d mod pq par les restes chinois
+// "x" doit tre infrieur  pq ; rend la taille du rsultat
+int LLExpModCRT(cle_crt*k, mot*r, int sx, mot*x)
+{
+    int s1;  mot m1[MAX];   // x^dP mod p
+    int s2;  mot m2[MAX];   // x^dQ mod q
+    int sh;  mot h[MAX];
+    int sr;
+    ctx_mod*cp;
+    ctx_mod*cq;
+    demi_crt demi;
+
+    cp=&k->cp;
+    cq=&k->cq;
+    if (k->aide!=NULL)
+    {   // m2 sur le thread auxiliaire, m1 ici
+        demi.c=cq; demi.r=m2;
+        demi.sx=sx; demi.x=x;
+        demi.se=k->sdq; demi.e=k->dq;
+        AideLance(k->aide,DemiCRT,&demi);
+        s1=LLExpModMont(cp,m1,sx,x,k->sdp,k->dp);
+        AideJoint(k->aide);
+        s2=demi.sr;
+    }
+    else
+    {
+        s2=LLExpModMont(cq,m2,sx,x,k->sdq,k->dq);
+        s1=LLExpModMont(cp,m1,sx,x,k->sdp,k->dp);
+    }
+    // h = (m1 - m2 mod p) mod p
+    sh=s2; LCopy(h,s2,m2);
+    ModuloCtx(cp,&sh,h);
+    if (LCmp(s1,m1,sh,h)>=0)
+    {
+        sh=LSub(h,s1,m1,sh,h);
+    }
+    else
+    {   // m1 + p - (m2 mod p)
+        sh=LSub(h,cp->sn,cp->n,sh,h);
+        sh=LAdd(h,sh,h,s1,m1);
+    }
+    // h = qInv.h mod p
+    sh=LLMulMod(cp,sh,h,k->sqi,k->qi);
+    // r = m2 + h.q
+    sr=LLMul(r,sh,h,cq->sn,cq->n);
+    sr=LAdd(r,sr,r,s2,m2);
+    return sr;
+}
+
+/////////////////////////////////////////////////////////
+// masquage des oprations prives
+// Pour calculer x^d mod n sans que le temps dpende de x, on calcule
+// (x.r^e)^d = x^d.r puis on multiplie par r^-1. Le masque garde r^e et
+// r^-1 mod n ; aprs chaque usage les deux sont levs au carr, ce
+// qui donne le masque de r^2 : une opration masque ne cote que deux
+// produits et deux carrs de plus, au lieu d'une exponentiation et d'un
+// inverse. r est tir une seule fois dans /dev/urandom.
+// Comme un contexte, un masque n'appartient qu' un seul fil
+// d'excution : chaque fil a le sien pour chaque cl, sans verrou.
+/////////////////////////////////////////////////////////
+
+// masque d'une cl
+typedef struct
+{
+    int sa; mot a[MAX];     // r^e mod n
+    int sb; mot b[MAX];     // r^-1 mod n
+} masque_rsa;
+
+// "so" octets alatoires de /dev/urandom ; rend 0 ou -1
+static int AleaOctets(int so, uint8_t*o)
+{
+    int fd;
+    ssize_t l;
+    fd=open("/dev/urandom",O_RDONLY);
+    if (fd<0) return -1;
+    while (so>0)
+    {
+        l=read(fd,o,so);
+        if (l<=0) break;
+        o+=l;
+        so-=l;
+    }
+    close(fd);
+    return so==0 ? 0 : -1;
+}
+
+// tirage d'un masque pour le modulo du contexte et l'exposant public "e"
+// rend 0, ou -1 si le tirage choue
+int MasqueInit(ctx_mod*c, masque_rsa*m, int se, mot*e)
+{
+    int sr; mot r[MAX];
+    int sn;
+
+    sn=c->sn;
+    do
+    {   // r de sn-1 chiffres, donc infrieur  n, inversible modulo n
+        if (AleaOctets((sn-1)*MOT_OCTETS,(uint8_t*)r)!=0) return -1;
+        sr=sn-1;
+        while ( (sr>0) && (r[sr-1]==0) ) sr--;
+        m->sb= sr>0 ? LInvMod(m->b,sr,r,sn,c->n) : -1;
+    } while (m->sb<0);
+    m->sa=LLExpModPub(c,m->a,sr,r,se,e);
+    return 0;
+}
+
+// x = x.r^e mod n, "x" de taille au plus sn ; rend la taille de x
+int MasqueApplique(ctx_mod*c, masque_rsa*m, int sx, mot*x)
+{
+    return LLMulMod(c,sx,x,m->sa,m->a);
+}
+
+// y = y.r^-1 mod n puis passage au masque de r^2 ; rend la taille de y
+int MasqueRetire(ctx_mod*c, masque_rsa*m, int sy, mot*y)
+{
+    sy=LLMulMod(c,sy,y,m->sb,m->b);
+    m->sa=LLSqrMod(c,m->sa,m->a);
+    m->sb=LLSqrMod(c,m->sb,m->b);
+    return sy;
+}
+
+// opration prive masque r = x^d mod n (sn chiffres)
+// "x" infrieur  n ; rend la taille du rsultat
+int LLExpModMasque(ctx_mod*c, masque_rsa*m, mot*r, int sx, mot*x, int sd, mot*d)
+{
+    mot t[MAX];
+    int st;
+    LCopy(t,sx,x);
+    st=MasqueApplique(c,m,sx,t);
+    st=LLExpModCtx(c,r,st,t,sd,d);
+    return MasqueRetire(c,m,st,r);
+}
+
+/////////////////////////////////////////////////////////
+// magasin de cls binaire projet en mmoire
+// Le fichier commence par un en-tte de 64 octets suivi d'enregistrements
+// de taille fixe cle_stockee,  l'offset 64 + i*sizeof(cle_stockee).
+// Chaque enregistrement contient la cl (n, e, d, p, q), les paramtres
+// des restes chinois et les constantes de rduction (precalc) de n, p
+// et q. Ces structures ne contiennent aucun pointeur : le fichier est
+// projet en lecture seule (mmap) et les contextes pointent directement
+// dans les pages projetes, partages entre processus, sans analyse ni
+// copie. Le format dpend de LIMB_BITS, MAX et du boutisme, vrifis 
+// l'ouverture.
+/////////////////////////////////////////////////////////
+
+#define STOCK_VERSION 1
+#define STOCK_BOUTISME 0x01020304
+
+typedef struct
+{
+    char magique[4];        // "RSAK"
+    uint32_t version;
+    uint32_t boutisme;      // STOCK_BOUTISME dans l'ordre de la machine
+    uint32_t limb_bits;
+    uint32_t max;           // MAX
+    uint32_t taille;        // sizeof(cle_stockee)
+    uint64_t nb;            // nombre de cls
+    uint8_t reserve[32];
+} entete_stock;
+
+// une cl ; sp = sq = 0 pour une cl sans facteurs (publique)
+typedef struct
+{
+    int32_t sn, se, sd, sp, sq, sdp, sdq, sqi;
+    mot n[MAX];
+    mot e[MAX];
+    mot d[MAX];
+    mot p[MAX];
+    mot q[MAX];
+    mot dp[MAX];            // d mod (p-1)
+    mot dq[MAX];            // d mod (q-1)
+    mot qi[MAX];            // q^-1 mod p
+    precalc pcn;            // constantes de n
+    precalc pcp;            // constantes de p
+    precalc pcq;            // constantes de q
+} cle_stockee;
+
+// magasin ouvert
+typedef struct
+{
+    void* base;             // projection du fichier
+    size_t taille;
+    uint64_t nb;
+    cle_stockee* cles;
+} stock_rsa;
+
+// remplit l'enregistrement "k" ; "sp" et "sq" nuls si les facteurs
+// ne sont pas connus ; rend 0 ou -1
+int StockPrepare(cle_stockee*k, int sn, mot*n, int se, mot*e, int sd, mot*d,
+                 int sp, mot*p, int sq, mot*q)
+{
+    if ( (sn<2) || (sn>MAX) || (se>MAX) || (sd>MAX) || (sp>MAX) || (sq>MAX) ) return -1;
+    memset(k,0,sizeof(cle_stockee));
+    k->sn=sn; LCopy(k->n,sn,n);
+    k->se=se; LCopy(k->e,se,e);
+    k->sd=sd; LCopy(k->d,sd,d);
+    PrecalcCalcule(&k->pcn,LHash(sn,n),sn,n);
+    if ( (sp>0) && (sq>0) )
+    {
+        if (CRTParametres(sp,p,sq,q,sd,d,&k->sdp,k->dp,&k->sdq,k->dq,&k->sqi,k->qi)!=0)
+        {
+            return -1;
+        }
+        k->sp=sp; LCopy(k->p,sp,p);
+        k->sq=sq; LCopy(k->q,sq,q);
+        PrecalcCalcule(&k->pcp,LHash(sp,p),sp,p);
+        PrecalcCalcule(&k->pcq,LHash(sq,q),sq,q);
+    }
+    return 0;
+}
+
+// criture d'un magasin de "nb" cls dans "f" ; rend 0 ou -1
+int StockEcrit(FILE*f, int nb, cle_stockee*k)
+{
+    entete_stock t;
+    memset(&t,0,sizeof(t));
+    memcpy(t.magique,"RSAK",4);
+    t.version=STOCK_VERSION;
+    t.boutisme=STOCK_BOUTISME;
+    t.limb_bits=LIMB_BITS;
+    t.max=MAX;
+    t.taille=sizeof(cle_stockee);
+    t.nb=nb;
+    if (fwrite(&t,sizeof(t),1,f)!=1) return -1;
+    if ( (nb>0) && (fwrite(k,sizeof(cle_stockee),nb,f)!=(size_t)nb) ) return -1;
+    return fflush(f)==0 ? 0 : -1;
+}
+
+// projection en lecture seule du magasin ouvert sur "fd" ; rend 0 ou -1
+int StockOuvreFd(stock_rsa*s, int fd)
+{
+    struct stat st;
+    entete_stock*t;
+
+    if (fstat(fd,&st)!=0) return -1;
+    if ((size_t)st.st_size<sizeof(entete_stock)) return -1;
+    s->taille=st.st_size;
+    s->base=mmap(NULL,s->taille,PROT_READ,MAP_SHARED,fd,0);
+    if (s->base==MAP_FAILED) return -1;
+    t=s->base;
+    if ( (memcmp(t->magique,"RSAK",4)!=0) || (t->version!=STOCK_VERSION)
+      || (t->boutisme!=STOCK_BOUTISME) || (t->limb_bits!=LIMB_BITS)
+      || (t->max!=MAX) || (t->taille!=sizeof(cle_stockee))
+      || (t->nb>(s->taille-sizeof(entete_stock))/sizeof(cle_stockee)) )
+    {
+        munmap(s->base,s->taille);
+        return -1;
+    }
+    s->nb=t->nb;
+    s->cles=(cle_stockee*)((char*)s->base+sizeof(entete_stock));
+    return 0;
+}
+
+// ouverture du magasin "nom" ; rend 0 ou -1
+int StockOuvre(stock_rsa*s, const char*nom)
+{
+    int fd;
+    int r;
+    fd=open(nom,O_RDONLY);
+    if (fd<0) return -1;
+    r=StockOuvreFd(s,fd);
+    close(fd);      // la projection reste valide
+    return r;
+}
+
+void StockFerme(stock_rsa*s)
+{
+    munmap(s->base,s->taille);
+    s->base=NULL;
+    s->nb=0;
+}
+
+// constantes "pc" cohrentes pour un modulo de "sn" chiffres
+static int PrecalcValide(precalc*pc, int sn)
+{
+    return (pc->sn==sn) && (pc->count>=0) && (pc->count<LIMB_BITS)
+        && (pc->smu>=0) && (pc->smu<=MAX+2);
+}
+
+// l'enregistrement "k" venant du fichier, toutes les tailles qui servent
+//  copier ou  lire ses chiffres sont vrifies avant usage
+static int StockValide(cle_stockee*k)
+{
+    if ( (k->sn<2) || (k->sn>MAX) ) return 0;
+    if ( (k->se<0) || (k->se>MAX) || (k->sd<0) || (k->sd>MAX)
+      || (k->sp<0) || (k->sp>MAX) || (k->sq<0) || (k->sq>MAX)
+      || (k->sdp<0) || (k->sdp>MAX) || (k->sdq<0) || (k->sdq>MAX)
+      || (k->sqi<0) || (k->sqi>MAX) ) return 0;
+    return PrecalcValide(&k->pcn,k->sn) && PrecalcValide(&k->pcp,k->sp)
+        && PrecalcValide(&k->pcq,k->sq);
+}
+
+// cl numro "i", ou NULL si elle n'existe pas ou si l'enregistrement
+// est incohrent
+cle_stockee* StockCle(stock_rsa*s, uint64_t i)
+{
+    if (i>=s->nb) return NULL;
+    return StockValide(s->cles+i) ? s->cles+i : NULL;
+}
+
+// contexte modulo n de la cl "k", constantes prises dans le magasin
+// rend 0 ou -1
+int StockCtx(ctx_mod*c, cle_stockee*k)
+{
+    if ( (k==NULL) || !StockValide(k) ) return -1;
+    return CtxInitPc(c,&k->pcn);
+}
+
+// cl CRT de la cl "k" (qui doit avoir ses facteurs) ; rend 0 ou -1
+int StockCRT(cle_crt*c, cle_stockee*k)
+{
+    if ( (k==NULL) || !StockValide(k) || (k->sp==0) || (k->sq==0) ) return -1;
+    c->aide=NULL;
+    if (CtxInitPc(&c->cp,&k->pcp)!=0) return -1;
+    if (CtxInitPc(&c->cq,&k->pcq)!=0)
+    {
+        CtxLibere(&c->cp);
+        return -1;
+    }
+    c->sdp=k->sdp; LCopy(c->dp,k->sdp,k->dp);
+    c->sdq=k->sdq; LCopy(c->dq,k->sdq,k->dq);
+    c->sqi=k->sqi; LCopy(c->qi,k->sqi,k->qi);
+    return 0;
+}
+
+/////////////////////////////////////////////////////////
+// traitement par lots
+// Un lot est un tableau de tches indpendantes r = x^e mod n (cl et
+// message propres  chaque tche). Le lot est dcoup en tranches
+// contigus, une par ouvrier d'un groupe de threads fixe. Chaque
+// ouvrier vide sa tranche par le dbut et, quand elle est puise,
+// vole une tche  la fin de la tranche d'un autre ouvrier ; chaque
+// tranche a son propre mutex. Les rsultats sont crits  la place de
+// chaque tche, donc dans l'ordre du lot.
+// Chaque ouvrier a son propre contexte (zones de travail), rinitialis
+// quand le modulo change ; les constantes par modulo viennent du cache.
+/////////////////////////////////////////////////////////
+
+// une tche : r = x^e mod n
+typedef struct
+{
+    int sn; mot*n;      // modulo
+    int se; mot*e;      // exposant
+    int sx; mot*x;      // message, infrieur  n
+    int sr; mot*r;      // rsultat (sn chiffres), sr = -1 en cas d'erreur
+} tache_rsa;
+
+struct pool_rsa;
+
+// un ouvrier et sa tranche [debut, fin) du lot en cours
+typedef struct
+{
+    struct pool_rsa* pool;
+    pthread_t th;
+    pthread_mutex_t m;  // protge debut et fin
+    int debut;
+    int fin;
+    int init;           // le contexte est initialis
+    ctx_mod c;
+} ouvrier_rsa;
+
+typedef struct pool_rsa
+{
+    int nb;             // nombre d'ouvriers
+    ouvrier_rsa* ouv;
+    pthread_mutex_t m;  // protge les champs qui suivent
+    pthread_cond_t debut;
+    pthread_cond_t fin;
+    int generation;     // numro du lot en cours
+    int actifs;         // ouvriers n'ayant pas fini le lot
+    int arret;
+    tache_rsa* taches;
+} pool_rsa;
+
+// excution d'une tche avec le contexte de l'ouvrier "o"
+static void TacheExec(ouvrier_rsa*o, tache_rsa*t)
+{
+    if ( (!o->init) || (LCmp(o->c.sn,o->c.n,t->sn,t->n)!=0) )
+    {
+        if (o->init) CtxLibere(&o->c);
+        o->init=(CtxInit(&o->c,t->sn,t->n)==0);
+        if (!o->init)
+        {
+            t->sr=-1;
+            return;
+        }
+        CtxReduction(&o->c,RED_MONTGOMERY);
+    }
+    t->sr=LLExpModCtx(&o->c,t->r,t->sx,t->x,t->se,t->e);
+}
+
+// prend une tche au dbut de sa propre tranche
+// rend son indice, ou -1 si la tranche est vide
+static int TachePrend(ouvrier_rsa*o)
+{
+    int i;
+    pthread_mutex_lock(&o->m);
+    i= o->debut<o->fin ? o->debut++ : -1;
+    pthread_mutex_unlock(&o->m);
+    return i;
+}
+
+// vole une tche  la fin de la tranche d'un autre ouvrier
+static int TacheVole(ouvrier_rsa*o)
+{
+    int i, k;
+    int nb;
+    ouvrier_rsa*v;
+    nb=o->pool->nb;
+    for (k=1;k<nb;k++)
+    {
+        v=o->pool->ouv+((o-o->pool->ouv)+k)%nb;
+        pthread_mutex_lock(&v->m);
+        i= v->debut<v->fin ? --v->fin : -1;
+        pthread_mutex_unlock(&v->m);
+        if (i>=0) return i;
+    }
+    return -1;
+}
+
+static void* Ouvrier(void*arg)
+{
+    ouvrier_rsa*o=arg;
+    pool_rsa*p=o->pool;
+    int gen;
+    int i;
+
+    gen=0;
+    for (;;)
+    {
+        pthread_mutex_lock(&p->m);
+        while ( (p->generation==gen) && (!p->arret) ) pthread_cond_wait(&p->debut,&p->m);
+        if (p->arret)
+        {
+            pthread_mutex_unlock(&p->m);
+            break;
+        }
+        gen=p->generation;
+        pthread_mutex_unlock(&p->m);
+
+        while ( ((i=TachePrend(o))>=0) || ((i=TacheVole(o))>=0) )
+        {
+            TacheExec(o,p->taches+i);
+        }
+        // aucune tche n'est ajoute en cours de lot : toutes les
+        // tranches sont vides
+        pthread_mutex_lock(&p->m);
+        if (--p->actifs==0) pthread_cond_signal(&p->fin);
+        pthread_mutex_unlock(&p->m);
+    }
+    if (o->init) CtxLibere(&o->c);
+    return NULL;
+}
+
+// arrt des ouvriers et libration du groupe
+void PoolDetruit(pool_rsa*p)
+{
+    int i;
+    pthread_mutex_lock(&p->m);
+    p->arret=1;
+    pthread_cond_broadcast(&p->debut);
+    pthread_mutex_unlock(&p->m);
+    for (i=0;i<p->nb;i++)
+    {
+        pthread_join(p->ouv[i].th,NULL);
+        pthread_mutex_destroy(&p->ouv[i].m);
+    }
+    pthread_mutex_destroy(&p->m);
+    pthread_cond_destroy(&p->debut);
+    pthread_cond_destroy(&p->fin);
+    free(p->ouv);
+    p->ouv=NULL;
+    p->nb=0;
+}
+
+// cration d'un groupe de "nb" ouvriers ; rend 0 ou -1
+int PoolCree(pool_rsa*p, int nb)
+{
+    int i;
+    if (nb<1) nb=1;
+    p->ouv=calloc(nb,sizeof(ouvrier_rsa));
+    if (p->ouv==NULL) return -1;
+    p->nb=0;
+    p->generation=0;
+    p->actifs=0;
+    p->arret=0;
+    p->taches=NULL;
+    pthread_mutex_init(&p->m,NULL);
+    pthread_cond_init(&p->debut,NULL);
+    pthread_cond_init(&p->fin,NULL);
+    for (i=0;i<nb;i++)
+    {
+        p->ouv[i].pool=p;
+        pthread_mutex_init(&p->ouv[i].m,NULL);
+        if (pthread_create(&p->ouv[i].th,NULL,Ouvrier,p->ouv+i)!=0) break;
+        p->nb++;
+    }
+    if (p->nb==0)
+    {
+        PoolDetruit(p);
+        return -1;
+    }
+    return 0;
+}
+
+// excution d'un lot de "nb" tches, rend quand toutes sont termines
+// un seul lot  la fois par groupe ; rend le nombre de tches en erreur
+int PoolLot(pool_rsa*p, tache_rsa*t, int nb)
+{
+    int i;
+    int err;
+    if (nb<=0) return 0;
+    // tranches contigus de tailles gales  une tche prs
+    for (i=0;i<p->nb;i++)
+    {
+        pthread_mutex_lock(&p->ouv[i].m);
+        p->ouv[i].debut=(int)((long)nb*i/p->nb);
+        p->ouv[i].fin=(int)((long)nb*(i+1)/p->nb);
+        pthread_mutex_unlock(&p->ouv[i].m);
+    }
+    pthread_mutex_lock(&p->m);
+    p->taches=t;
+    p->actifs=p->nb;
+    p->generation++;
+    pthread_cond_broadcast(&p->debut);
+    while (p->actifs>0) pthread_cond_wait(&p->fin,&p->m);
+    p->taches=NULL;
+    pthread_mutex_unlock(&p->m);
+    err=0;
+    for (i=0;i<nb;i++) if (t[i].sr<0) err++;
+    return err;
+}
+
+
+//
+// fonction de lecture et d'affichage en hexadcimal
+// ncessaire uniquement pour le mode console
+//////////////////////////////////////////////////////
+
+// convertit un caractre ascii en uint8_t
+// si le caractre ascii ne correspond pas  un chiffre, rend le mot tout  1
+uint8_t digit(char c)
+{
+	if ( (c>='0') && (c<='9') ) return c-'0';
+	if ( (c>='a') && (c<='z') ) return c-'a'+10;
+	if ( (c>='A') && (c<='Z') ) return c-'A'+10;
+	return (uint8_t)-1;
+}
+
+// dcalage de 4 symboles binaires vers la gauche
+/////////////////////////////////////////////////
+int LShl4(int sx, mot*x)
+{
+    int i;
+    mot c;
+    mot t;
+    c=0;
+    for (i=0;i<sx;i++)
+    {
+        t=x[i];
+        x[i]=(x[i]<<4)+c;
+        c=t>>(LIMB_BITS-4);
+    }
+    if (c!=0)
+    {
+        x[i++]=c;
+    }
+    return i;
+}
+
+// fonctions de conversion chaine hexa --> nombre
+// un seul passage : la longueur de la chane est d'abord mesure, puis
+// chaque symbole est plac directement  son rang, depuis le poids faible
+// rend le nombre de digits
+int AToL(mot*r,char*s)
+{
+    int nc;     // nombre de symboles hexadcimaux
+    int sr;
+    int k;
+    nc=0;
+    while (digit(s[nc])<16) nc++;
+    sr=(nc+2*MOT_OCTETS-1)/(2*MOT_OCTETS);
+    for (k=0;k<sr;k++) r[k]=0;
+    for (k=0;k<nc;k++)
+    {   // symbole de rang k depuis le poids faible
+        r[k/(2*MOT_OCTETS)]|=(mot)digit(s[nc-1-k])<<(4*(k%(2*MOT_OCTETS)));
+    }
+    while ( (sr>0) && (r[sr-1]==0) ) sr--;
+    return sr;
+}
+
+// conversion d'une suite d'octets big endian en long
+// rend la taille du rsultat en chiffres
+int LFromOctetsBE(mot*r, int so, uint8_t*o)
+{
+    int i;
+    int sr;
+    sr=(so+MOT_OCTETS-1)/MOT_OCTETS;
+    for (i=0;i<sr;i++) r[i]=0;
+    for (i=0;i<so;i++)
+    {
+        r[i/MOT_OCTETS]|=(mot)o[so-1-i]<<(8*(i%MOT_OCTETS));
+    }
+    while ( (sr>0) && (r[sr-1]==0) ) sr--;
+    return sr;
+}
+
+// conversion d'un long en exactement "so" octets big endian
+// (complts par des zros  gauche)
+// rend so, ou -1 si "x" ne tient pas sur so octets
+int LToOctetsBE(uint8_t*o, int so, int sx, mot*x)
+{
+    int i;
+    mot t;
+    while ( (sx>0) && (x[sx-1]==0) ) sx--;
+    for (i=0;i<so;i++)
+    {
+        t= i/MOT_OCTETS<sx ? x[i/MOT_OCTETS] : 0;
+        o[so-1-i]=t>>(8*(i%MOT_OCTETS));
+    }
+    for (i=so;i<sx*MOT_OCTETS;i++)
+    {
+        if ( (x[i/MOT_OCTETS]>>(8*(i%MOT_OCTETS)))&0xff ) return -1;
+    }
+    return so;
+}
+
+static const char hexa[]="0123456789abcdef";
+
+// "so" octets vers 2.so symboles hexadcimaux, sans zro final
+static void HexOctets_c(char*h, int so, uint8_t*o)
+{
+    int i;
+    for (i=0;i<so;i++)
+    {
+        h[2*i]=hexa[o[i]>>4];
+        h[2*i+1]=hexa[o[i]&15];
+    }
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+// mme conversion par blocs de 16 octets : les demi-octets sont spars,
+// traduits par PSHUFB dans la table des symboles puis entrelacs
+__attribute__((target("ssse3")))
+static void HexOctets_ssse3(char*h, int so, uint8_t*o)
+{
+    const __m128i table=_mm_loadu_si128((const __m128i*)hexa);
+    const __m128i quinze=_mm_set1_epi8(15);
+    __m128i v, fort, faible;
+    int i;
+    for (i=0;i+16<=so;i+=16)
+    {
+        v=_mm_loadu_si128((const __m128i*)(o+i));
+        fort=_mm_shuffle_epi8(table,_mm_and_si128(_mm_srli_epi16(v,4),quinze));
+        faible=_mm_shuffle_epi8(table,_mm_and_si128(v,quinze));
+        _mm_storeu_si128((__m128i*)(h+2*i),_mm_unpacklo_epi8(fort,faible));
+        _mm_storeu_si128((__m128i*)(h+2*i+16),_mm_unpackhi_epi8(fort,faible));
+    }
+    HexOctets_c(h+2*i,so-i,o+i);
+}
+
+static void HexOctets(char*h, int so, uint8_t*o)
+{
+    if ( (so>=64) && __builtin_cpu_supports("ssse3") ) HexOctets_ssse3(h,so,o);
+    else HexOctets_c(h,so,o);
+}
+#else
+#define HexOctets HexOctets_c
+#endif
+
+// criture d'un entier en hexadcimal dans "h", chaque chiffre sur
+// 2*MOT_OCTETS symboles, du poids fort au poids faible, avec zro final
+// "h" doit avoir au moins 2*MOT_OCTETS*sx+1 caractres
+// rend le nombre de symboles crits
+int LToHex(char*h, int sx, mot*x)
+{
+    uint8_t o[MAX_OCTETS+2*MOT_OCTETS];
+    uint8_t*p;
+    int so;
+    so=sx*MOT_OCTETS;
+    p= so<=(int)sizeof(o) ? o : malloc(so);
+    if (p==NULL) so=0;
+    else
+    {
+        LToOctetsBE(p,so,sx,x);
+        HexOctets(h,so,p);
+        if (p!=o) free(p);
+    }
+    h[2*so]=0;
+    return 2*so;
+}
+
+// affichage d'un entier en hexadcimal, en une seule criture
+///////////////////////////////////////
+void affiche_hexa(int sx,mot*x)
+{
+    char h[4*MAX_OCTETS+4*MOT_OCTETS+2];
+    char*p;
+    int nh;
+    p= 2*MOT_OCTETS*sx+2<=(int)sizeof(h) ? h : malloc(2*MOT_OCTETS*sx+2);
+    if (p==NULL) return;
+    nh=LToHex(p,sx,x);
+    p[nh++]='\n';
+    fwrite(p,1,nh,stdout);
+    if (p!=h) free(p);
+}
+
+// conversion d'une suite d'octets little endian en long
+// rend la taille du rsultat en chiffres
+int LFromOctets(mot*r, int so, uint8_t*o)
+{
+    int i;
+    int sr;
+    sr=(so+MOT_OCTETS-1)/MOT_OCTETS;
+    for (i=0;i<sr;i++) r[i]=0;
+    for (i=0;i<so;i++)
+    {
+        r[i/MOT_OCTETS]|=(mot)o[i]<<(8*(i%MOT_OCTETS));
+    }
+    while ( (sr>0) && (r[sr-1]==0) ) sr--;
+    return sr;
+}
+
+// conversion d'un long en suite d'octets little endian
+// rend le nombre d'octets significatifs
+int LToOctets(uint8_t*o, int sx, mot*x)
+{
+    int i;
+    int so;
+    so=sx*MOT_OCTETS;
+    for (i=0;i<so;i++)
+    {
+        o[i]=x[i/MOT_OCTETS]>>(8*(i%MOT_OCTETS));
+    }
+    while ( (so>0) && (o[so-1]==0) ) so--;
+    return so;
+}
+
+/////////////////////////////////////////////////////////
+// gnration de cls
+// Un candidat premier impair c0 de la taille voulue est tir au hasard
+// (/dev/urandom), avec ses deux bits de poids fort  1 pour que p.q ait
+// exactement la taille de la cl. Ses restes modulo les petits premiers
+// impairs infrieurs  GEN_BORNE sont calculs une fois ; le crible
+// marque alors les dcalages c0 + 2i (i < GEN_CRIBLE) divisibles par
+// l'un d'eux, sans aucune division longue. Les candidats restants
+// passent le test de Miller-Rabin par sries, un candidat par processeur :
+// le thread appelant et nth-1 threads auxiliaires (aide_fj) font chacun
+// tous les tours d'un candidat, le premier de la srie qui passe est
+// retenu. Chaque thread a son propre contexte, les constantes du
+// candidat ne passent pas par le cache ; la cl retenue non plus
+// (StockPrepare calcule ses constantes avec PrecalcCalcule et ses
+// paramtres CRT avec CRTParametres) : gnrer beaucoup de cls ne
+// remplit pas le cache.
+// d = e^-1 mod ppcm(p-1,q-1), comme pour les cls listes dans puk.c ;
+// les paramtres des restes chinois sont calculs par StockPrepare.
+/////////////////////////////////////////////////////////
+
+#define GEN_BORNE    16384      // borne des petits premiers du crible
+#define GEN_CRIBLE   4096       // nombre de candidats par fentre du crible
+#define GEN_BITS_MIN 256        // taille de cl minimale
+
+// un candidat et son test, confi  un thread
+typedef struct
+{
+    int sn; mot n[MAX];     // candidat
+    int ok;                 // rsultat du test
+    uint64_t graine;        // tirage des bases de Miller-Rabin
+    precalc pc;             // constantes du candidat
+} gen_essai;
+
+// gnrateur de cls
+typedef struct
+{
+    int fd;                 // /dev/urandom
+    int nth;                // nombre de threads du test
+    aide_fj* aide;          // nth-1 threads auxiliaires
+    gen_essai* essai;       // nth candidats
+    int np;                 // nombre de petits premiers
+    uint16_t premiers[GEN_BORNE/2];
+    uint8_t crible[GEN_CRIBLE];     // 1 si c0 + 2i est compos
+} gen_rsa;
+
+// "so" octets alatoires ; rend 0 ou -1
+static int GenAlea(gen_rsa*g, int so, uint8_t*o)
+{
+    ssize_t l;
+    while (so>0)
+    {
+        l=read(g->fd,o,so);
+        if (l<=0) return -1;
+        o+=l;
+        so-=l;
+    }
+    return 0;
+}
+
+// reste de la division de "x" par le petit entier "d" (d < 2^16)
+static uint32_t LModU16(int sx, mot*x, uint32_t d)
+{
+    int i,j;
+    uint32_t r;
+    r=0;
+    for (i=sx-1;i>=0;i--)
+    {
+        for (j=MOT_OCTETS-1;j>=0;j--)
+        {
+            r=((r<<8)|(uint8_t)(x[i]>>(8*j)))%d;
+        }
+    }
+    return r;
+}
+
+// chiffre pseudo-alatoire xorshift64 du candidat "t"
+static mot GenMot(gen_essai*t)
+{
+    t->graine^=t->graine<<13;
+    t->graine^=t->graine>>7;
+    t->graine^=t->graine<<17;
+    return (mot)t->graine;
+}
+
+// nombre de tours de Miller-Rabin pour un candidat alatoire de
+// "bits" bits (probabilit d'erreur infrieure  2^-80)
+static int GenTours(int bits)
+{
+    if (bits>=1300) return 2;
+    if (bits>=850) return 3;
+    if (bits>=650) return 4;
+    if (bits>=550) return 5;
+    if (bits>=450) return 6;
+    if (bits>=400) return 7;
+    if (bits>=350) return 8;
+    if (bits>=300) return 9;
+    if (bits>=250) return 12;
+    if (bits>=200) return 15;
+    if (bits>=150) return 18;
+    return 27;
+}
+
+// test de Miller-Rabin du candidat t->n, impair ; le premier tour est
+// fait en base 2, les suivants en bases pseudo-alatoires
+// rend 1 si le candidat est probablement premier
+static int MillerRabin(gen_essai*t)
+{
+    ctx_mod c;
+    int sn;
+    int sm; mot m[MAX];     // n-1
+    int sd; mot d[MAX];     // n-1 = 2^s.d, d impair
+    int sa; mot a[MAX];     // base
+    int sy; mot y[MAX];
+    int s;
+    int tours;
+    int i,j;
+    int ok;
+    mot un=1;
+
+    sn=t->sn;
+    PrecalcCalcule(&t->pc,0,sn,t->n);
+    if (CtxInitPc(&c,&t->pc)!=0) return 0;
+    CtxReduction(&c,RED_BARRETT);
+    sm=LSub(m,sn,t->n,1,&un);
+    for (i=0;m[i]==0;i++);
+    s=i*LIMB_BITS;
+    sd=sm-i; LCopy(d,sd,m+i);
+    if ( (d[0]&1)==0 )
+    {
+        j=0;
+        while ( ((d[0]>>j)&1)==0 ) j++;
+        LShr(sd,d,j);
+        if (d[sd-1]==0) sd--;
+        s+=j;
+    }
+    tours=GenTours(LBits(sn,t->n));
+    ok=1;
+    for (i=0;(i<tours)&&ok;i++)
+    {
+        if (i==0)
+        {
+            a[0]=2; sa=1;
+        }
+        else
+        {   // base de sn-1 chiffres, infrieure  n
+            for (j=0;j<sn-1;j++) a[j]=GenMot(t);
+            sa=sn-1;
+            while ( (sa>0) && (a[sa-1]==0) ) sa--;
+            if ( (sa==0) || ( (sa==1) && (a[0]<2) ) )
+            {
+                a[0]=2; sa=1;
+            }
+        }
+        sy=LLExpModMont(&c,y,sa,a,sd,d);
+        if ( ( (sy==1) && (y[0]==1) ) || (LCmp(sy,y,sm,m)==0) ) continue;
+        ok=0;
+        for (j=1;j<s;j++)
+        {
+            sy=LLSqrMod(&c,sy,y);
+            if ( (sy==1) && (y[0]==1) ) break;
+            if (LCmp(sy,y,sm,m)==0)
+            {
+                ok=1;
+                break;
+            }
+        }
+    }
+    CtxLibere(&c);
+    return ok;
+}
+
+static void GenTeste(void*arg)
+{
+    gen_essai*t=arg;
+    t->ok=MillerRabin(t);
+}
+
+// arrt des threads et libration du gnrateur
+void GenDetruit(gen_rsa*g)
+{
+    int i;
+    for (i=0;i<g->nth-1;i++) AideDetruit(g->aide+i);
+    free(g->aide);
+    free(g->essai);
+    if (g->fd>=0) close(g->fd);
+}
+
+// cration d'un gnrateur dont le test de primalit utilise "nth"
+// threads ; rend 0 ou -1
+int GenCree(gen_rsa*g, int nth)
+{
+    int i, j;
+    uint8_t*compose;
+
+    if (nth<1) nth=1;
+    g->nth=1;
+    g->aide=malloc(nth*sizeof(aide_fj));
+    g->essai=calloc(nth,sizeof(gen_essai));
+    g->fd=open("/dev/urandom",O_RDONLY);
+    compose=calloc(GEN_BORNE,1);
+    if ( (g->aide==NULL) || (g->essai==NULL) || (g->fd<0) || (compose==NULL) )
+    {
+        free(compose);
+        GenDetruit(g);
+        return -1;
+    }
+    // petits premiers impairs : crible d'Eratosthne
+    g->np=0;
+    for (i=3;i<GEN_BORNE;i+=2)
+    {
+        if (compose[i]) continue;
+        g->premiers[g->np++]=i;
+        for (j=i*i;j<GEN_BORNE;j+=2*i) compose[j]=1;
+    }
+    free(compose);
+    for (i=0;i<nth;i++)
+    {
+        if (GenAlea(g,sizeof(uint64_t),(uint8_t*)&g->essai[i].graine)!=0) break;
+        g->essai[i].graine|=1;
+    }
+    if (i<nth)
+    {
+        GenDetruit(g);
+        return -1;
+    }
+    for (;g->nth<nth;g->nth++)
+    {
+        if (AideCree(g->aide+g->nth-1)!=0) break;
+    }
+    return 0;
+}
+
+// test d'une srie de "nb" candidats g->essai[0..nb-1], un par thread
+// rend l'indice du premier candidat probablement premier, ou -1
+static int GenSerie(gen_rsa*g, int nb)
+{
+    int i;
+    for (i=1;i<nb;i++) AideLance(g->aide+i-1,GenTeste,g->essai+i);
+    GenTeste(g->essai);
+    for (i=1;i<nb;i++) AideJoint(g->aide+i-1);
+    for (i=0;i<nb;i++) if (g->essai[i].ok) return i;
+    return -1;
+}
+
+// nombre premier "p" de "bits" bits, deux bits de poids fort  1,
+// tel que "e" soit inversible modulo p-1
+// rend la taille de p, ou -1 si le tirage alatoire choue
+int GenPremier(gen_rsa*g, int bits, int se, mot*e, mot*p)
+{
+    int sn; mot c[MAX];     // candidat courant c0 + 2i
+    int sm; mot m[MAX];     // p-1
+    int sr; mot r[MAX];
+    mot deux=2;
+    mot un=1;
+    int i, k, nb;
+    uint32_t pr;
+
+    sn=(bits+LIMB_BITS-1)/LIMB_BITS;
+    for (;;)
+    {
+        // c0 alatoire impair, bits "bits"-1 et "bits"-2  1
+        if (GenAlea(g,sn*MOT_OCTETS,(uint8_t*)c)!=0) return -1;
+        k=bits-(sn-1)*LIMB_BITS;
+        if (k<LIMB_BITS) c[sn-1]&=((mot)1<<k)-1;
+        c[(bits-1)/LIMB_BITS]|=(mot)1<<((bits-1)%LIMB_BITS);
+        c[(bits-2)/LIMB_BITS]|=(mot)1<<((bits-2)%LIMB_BITS);
+        c[0]|=1;
+        // crible : c0 + 2i divisible par pr pour i = -c0/2 mod pr
+        memset(g->crible,0,GEN_CRIBLE);
+        for (k=0;k<g->np;k++)
+        {
+            pr=g->premiers[k];
+            i=(int)(((pr-LModU16(sn,c,pr))%pr)*((pr+1)/2)%pr);
+            for (;i<GEN_CRIBLE;i+=pr) g->crible[i]=1;
+        }
+        // sries de candidats restants
+        nb=0;
+        for (i=0;i<GEN_CRIBLE;i++)
+        {
+            if (i>0) sn=LAdd(c,sn,c,1,&deux);
+            if (LBits(sn,c)!=bits) break;
+            if (!g->crible[i])
+            {
+                g->essai[nb].sn=sn;
+                LCopy(g->essai[nb].n,sn,c);
+                nb++;
+            }
+            if ( (nb<g->nth) && (i<GEN_CRIBLE-1) ) continue;
+            if (nb==0) continue;
+            k=GenSerie(g,nb);
+            nb=0;
+            if (k<0) continue;
+            // e inversible modulo p-1
+            sm=LSub(m,g->essai[k].sn,g->essai[k].n,1,&un);
+            sr=se; LCopy(r,se,e);
+            Modulo(&sr,r,sm,m);
+            if ( (sr==0) || (LInvMod(r,sr,r,sm,m)<0) ) continue;
+            LCopy(p,g->essai[k].sn,g->essai[k].n);
+            return g->essai[k].sn;
+        }
+    }
+}
+
+// gnration d'une cl de "bits" bits d'exposant public "e" dans "k"
+// rend 0, ou -1 si la taille est hors limite ou si le tirage choue
+int GenCle(gen_rsa*g, int bits, int se, mot*e, cle_stockee*k)
+{
+    int sp; mot p[MAX];
+    int sq; mot q[MAX];
+    int sn; mot n[MAX];
+    int sd; mot d[MAX];
+    int s1; mot p1[MAX];    // p-1
+    int s2; mot q1[MAX];    // q-1
+    int sl; mot l[2*MAX];   // ppcm(p-1,q-1)
+    mot un=1;
+
+    if ( (bits<GEN_BITS_MIN) || (bits>MAX_BITS) ) return -1;
+    do
+    {
+        sp=GenPremier(g,bits-bits/2,se,e,p);
+        if (sp<0) return -1;
+        sq=GenPremier(g,bits/2,se,e,q);
+        if (sq<0) return -1;
+    } while (LCmp(sp,p,sq,q)==0);
+    sn=LLMul(n,sp,p,sq,q);
+    s1=LSub(p1,sp,p,1,&un);
+    s2=LSub(q1,sq,q,1,&un);
+    sl=LPpcm(l,s1,p1,s2,q1);
+    // e est inversible modulo p-1 et q-1, donc modulo leur ppcm
+    sd=LInvMod(d,se,e,sl,l);
+    if (sd<0) return -1;
+    return StockPrepare(k,sn,n,se,e,sd,d,sp,p,sq,q);
+}
+
+// chiffre puis dchiffre le message "m"
+// "hc" est le cryptogramme attendu, calcul par le moteur octet
+// (LIMB_BITS=8) : il sert de rfrence pour les autres tailles de mot
+int test_rsa(char*hn, char*hd, char*he, char*m, char*hc)
+{
+    // Modulo
+    int sn;
+    mot n[MAX];
+    ctx_mod ctx;
+    // Exposant priv
+    int sd;
+    mot d[MAX];
+    // Exposant public
+    int se;
+    mot e[4];
+
+    // Message clair
+    int sx; mot x[MAX];
+
+    // Cryptogramme
+    int sy; mot y[MAX+1];
+
+    // Message dchiffr
+    int st; mot t[MAX];
+
+    // Cryptogramme de rfrence
+    int sc; mot c[MAX];
+
+    // Vrification en lot
+    int ss[2]; mot*ps[2];
+    int sm[2]; mot*pm[2];
+    int ok[2];
+
+    uint8_t o[MAX_OCTETS+1];
+    int so;
+    char*erreur;
 
     sn=AToL(n,hn);
     sd=AToL(d,hd);
     se=AToL(e,he);
-    sx=strlen(m);
-    strcpy((char*)x,m);
+    sc=AToL(c,hc);
+    sx=LFromOctets(x,strlen(m),(uint8_t*)m);
+    if (CtxInit(&ctx,sn,n)!=0) return 1;
+    erreur=NULL;
+
+    st=LLExpMod(&ctx,t,sx,x,se,e);
+
+
+    printf("cryptogramme = ");
+    affiche_hexa(st,t);
+    if (LCmp(st,t,sc,c)!=0) erreur="cryptogramme diffrent du moteur octet";
+    sc=LLExpModMont(&ctx,c,sx,x,se,e);
+    if (LCmp(st,t,sc,c)!=0) erreur="cryptogramme diffrent en mode Montgomery";
+    sc=LLExpModFen(&ctx,c,sx,x,se,e);
+    if (LCmp(st,t,sc,c)!=0) erreur="cryptogramme diffrent en mode fentre";
+    CtxReduction(&ctx,RED_BARRETT);
+    sc=LLExpMod(&ctx,c,sx,x,se,e);
+    if (LCmp(st,t,sc,c)!=0) erreur="cryptogramme diffrent en mode Barrett";
+    CtxReduction(&ctx,RED_DIVISION);
+    sc=LLExpModPub(&ctx,c,sx,x,se,e);
+    if (LCmp(st,t,sc,c)!=0) erreur="cryptogramme diffrent par chane fixe";
+
+    // dchiffrement
+    sy=LLExpMod(&ctx,y,st,t,sd,d);
+    sc=LLExpModMont(&ctx,c,st,t,sd,d);
+    if (LCmp(sy,y,sc,c)!=0) erreur="dchiffrement diffrent en mode Montgomery";
+    sc=LLExpModFen(&ctx,c,st,t,sd,d);
+    if (LCmp(sy,y,sc,c)!=0) erreur="dchiffrement diffrent en mode fentre";
+    CtxReduction(&ctx,RED_BARRETT);
+    sc=LLExpModCtx(&ctx,c,st,t,sd,d);
+    if (LCmp(sy,y,sc,c)!=0) erreur="dchiffrement diffrent en mode Barrett";
+    CtxReduction(&ctx,RED_DIVISION);
+
+    // vrification en lot : y est la signature de t, pas de x
+    ss[0]=sy; ps[0]=y; sm[0]=st; pm[0]=t;
+    ss[1]=sy; ps[1]=y; sm[1]=sx; pm[1]=x;
+    if ( (LotVerifie(&ctx,se,e,2,ss,ps,sm,pm,ok)!=1) || !ok[0] )
+    {
+        erreur="vrification en lot errone";
+    }
+    CtxLibere(&ctx);
+    if (erreur!=NULL)
+    {
+        printf("%s\n",erreur);
+        return 1;
+    }
+    so=LToOctets(o,sy,y);
+    o[so]=0;
+
+    printf("message = %s\n",o); 
+    return strcmp(m,(char*)o);
+
+
+}
+
+// dchiffre le cryptogramme "hc" par les restes chinois
+//  partir des facteurs "hp" et "hq" de n, et compare au message "m"
+int test_crt(char*hn, char*hd, char*hp, char*hq, char*m, char*hc)
+{
+    int sn; mot n[MAX];
+    int sd; mot d[MAX];
+    int sp; mot p[MAX];
+    int sq; mot q[MAX];
+    int sc; mot c[MAX];
+    int sy; mot y[2*MAX];
+    int sz; mot z[2*MAX];
+    cle_crt k;
+    uint8_t o[MAX_OCTETS+1];
+    int so;
+    mot un=1;
+
+    sn=AToL(n,hn);
+    sd=AToL(d,hd);
+    sp=AToL(p,hp);
+    sq=AToL(q,hq);
+    sc=AToL(c,hc);
+    // vrification de la factorisation
+    sy=LLMul(y,sp,p,sq,q);
+    if (LCmp(sy,y,sn,n)!=0)
+    {
+        printf("p.q diffrent de n\n");
+        return 1;
+    }
+    if (CRTPrepare(&k,sp,p,sq,q,sd,d)!=0) return 1;
+    // qInv compar  q^(p-2) mod p (petit thorme de Fermat)
+    sy=LSub(y,sp,p,1,&un);
+    sy=LSub(y,sy,y,1,&un);
+    sz=LLExpModMont(&k.cp,z,sq,q,sy,y);
+    if (LCmp(sz,z,k.sqi,k.qi)!=0)
+    {
+        printf("qInv diffrent de q^(p-2) mod p\n");
+        CRTLibere(&k);
+        return 1;
+    }
+    printf("dP = ");
+    affiche_hexa(k.sdp,k.dp);
+    printf("dQ = ");
+    affiche_hexa(k.sdq,k.dq);
+    printf("qInv = ");
+    affiche_hexa(k.sqi,k.qi);
+
+    sy=LLExpModCRT(&k,y,sc,c);
+    // mmes calculs avec les deux moitis en parallle
+    if (CRTParallele(&k)!=0)
+    {
+        CRTLibere(&k);
+        return 1;
+    }
+    sz=LLExpModCRT(&k,z,sc,c);
+    CRTLibere(&k);
+    if (LCmp(sy,y,sz,z)!=0)
+    {
+        printf("restes chinois en parallle : rsultat diffrent\n");
+        return 1;
+    }
+    so=LToOctets(o,sy,y);
+    o[so]=0;
+
+    printf("message (CRT) = %s\n",o);
+    return strcmp(m,(char*)o);
+}
+
+// traitement d'un lot mlant plusieurs cls, chiffrements et
+// dchiffrements, compar aux cryptogrammes de rfrence
+int test_lot(void)
+{
+    static char* cles[][5]={
+        { "70a72c857055e465000cf9ca3d5d4a0f",
+          "21b115e328c83f80be588a636abb3f21", "10001",
+          "Hello RSA 128_1!", "548af4292204995331ff3c4934d774fb" },
+        { "89285e3254d3c85e712db22cd324994c702a50360d8de3a7",
+          "16dc0fb30e234c0fbd879db1ddc4dba8d6659dbc8bf68443", "3",
+          "Hello RSA 192_1!", "2888cd2cd87c01531f7f187737d960c0f2bca6c64f918872" },
+        { "68f4ae1b62792228457af7e8952f63a327cebb7aff6cfe596ee716e5477f7807",
+          "5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699", "10001",
+          "Hello RSA 256_2!", "1d436f9f3290e6d0076656cb5a06b024445a2c099134ca4f10d98615a65c0aa4" },
+    };
+    enum { NB_CLES=3, NB_TOURS=16, NB_TACHES=2*NB_CLES*NB_TOURS };
+    static mot n[NB_CLES][MAX], d[NB_CLES][MAX], e[NB_CLES][4];
+    static mot x[NB_CLES][MAX], c[NB_CLES][MAX];
+    static mot r[NB_TACHES][MAX];
+    int sn[NB_CLES], sd[NB_CLES], se[NB_CLES], sx[NB_CLES], sc[NB_CLES];
+    tache_rsa t[NB_TACHES];
+    pool_rsa p;
+    int i, k;
+    int err;
+
+    for (k=0;k<NB_CLES;k++)
+    {
+        sn[k]=AToL(n[k],cles[k][0]);
+        sd[k]=AToL(d[k],cles[k][1]);
+        se[k]=AToL(e[k],cles[k][2]);
+        sx[k]=LFromOctets(x[k],strlen(cles[k][3]),(uint8_t*)cles[k][3]);
+        sc[k]=AToL(c[k],cles[k][4]);
+    }
+    // tches paires : chiffrement, impaires : dchiffrement
+    for (i=0;i<NB_TACHES;i++)
+    {
+        k=(i/2)%NB_CLES;
+        t[i].sn=sn[k]; t[i].n=n[k];
+        if (i&1)
+        {
+            t[i].se=sd[k]; t[i].e=d[k];
+            t[i].sx=sc[k]; t[i].x=c[k];
+        }
+        else
+        {
+            t[i].se=se[k]; t[i].e=e[k];
+            t[i].sx=sx[k]; t[i].x=x[k];
+        }
+        t[i].r=r[i];
+    }
+    if (PoolCree(&p,4)!=0) return 1;
+    err=PoolLot(&p,t,NB_TACHES);
+    PoolDetruit(&p);
+    for (i=0;i<NB_TACHES;i++)
+    {
+        k=(i/2)%NB_CLES;
+        if (i&1) err+=(LCmp(t[i].sr,t[i].r,sx[k],x[k])!=0);
+        else err+=(LCmp(t[i].sr,t[i].r,sc[k],c[k])!=0);
+    }
+    printf("lot de %d tches sur 4 threads : %d erreur(s)\n",NB_TACHES,err);
+    return err;
+}
+
+// exponentiation multi-messages compare  LLExpMod, pour chaque noyau
+// disponible ; 11 messages, donc une dernire srie incomplte
+int test_multi(char*hn, char*hd, char*m)
+{
+    enum { NB=11 };
+    static mot x[NB][MAX], r[NB][MAX], ref[NB][MAX];
+    static int voies[]={1,4,8};
+    mot n[MAX], d[MAX];
+    mot*px[NB]; mot*pr[NB];
+    int sx[NB], sr[NB], sref[NB];
+    int sn, sd;
+    ctx_mod c;
+    int i, v;
+    int err;
+
+    sn=AToL(n,hn);
+    sd=AToL(d,hd);
+    if (CtxInit(&c,sn,n)!=0) return 1;
+    for (i=0;i<NB;i++)
+    {
+        sx[i]=LFromOctets(x[i],strlen(m),(uint8_t*)m);
+        x[i][0]+=i;
+        px[i]=x[i];
+        pr[i]=r[i];
+        sref[i]=LLExpMod(&c,ref[i],sx[i],x[i],sd,d);
+    }
+    err=0;
+    for (v=0;v<3;v++)
+    {
+        if (LLExpModMulti(&c,voies[v],NB,pr,sr,sx,px,sd,d)!=0)
+        {
+            printf("multi-messages %d voies : non disponible\n",voies[v]);
+            continue;
+        }
+        for (i=0;i<NB;i++) err+=(LCmp(sr[i],r[i],sref[i],ref[i])!=0);
+        printf("multi-messages %d voies : %d erreur(s)\n",voies[v],err);
+    }
+    CtxLibere(&c);
+    return err;
+}
+
+// exponentiations simultanes compares aux produits d'exponentiations
+// spares, avec le modulo "hn" puis avec n+1 (pair)
+int test_simultane(char*hn, char*hd, char*m)
+{
+    enum { K=3 };
+    static mot x[K][MAX], e[K][MAX];
+    mot n[MAX];
+    mot r[MAX], t[MAX], ref[MAX];
+    mot*px[K]; mot*pe[K];
+    int sx[K], se[K];
+    int sn, sr, st, sref;
+    int i, v;
+    int err;
+    ctx_mod c;
+    mot un=1;
+
+    sn=AToL(n,hn);
+    for (i=0;i<K;i++)
+    {
+        sx[i]=LFromOctets(x[i],strlen(m),(uint8_t*)m);
+        x[i][0]+=i;
+        px[i]=x[i];
+        pe[i]=e[i];
+    }
+    // exposants de tailles diffrentes : d, 65537, d/2^8
+    se[0]=AToL(e[0],hd);
+    se[1]=AToL(e[1],"10001");
+    se[2]=AToL(e[2],hd);
+    LCopy(e[2],se[2]-1,e[2]+1);
+    se[2]--;
+    err=0;
+    for (v=0;v<2;v++)
+    {
+        if (v==1) sn=LAdd(n,sn,n,1,&un);
+        if (CtxInit(&c,sn,n)!=0) return 1;
+        sref=1; ref[0]=1;
+        for (i=0;i<K;i++)
+        {
+            st=LLExpMod(&c,t,sx[i],x[i],se[i],e[i]);
+            sref=LLMulMod(&c,sref,ref,st,t);
+            if (i==1)
+            {
+                sr=LLExpMod2(&c,r,sx[0],x[0],se[0],e[0],sx[1],x[1],se[1],e[1]);
+                err+=(LCmp(sr,r,sref,ref)!=0);
+            }
+        }
+        sr=LLExpModMultiBase(&c,r,K,sx,px,se,pe);
+        err+=(LCmp(sr,r,sref,ref)!=0);
+        // exposants nuls
+        sr=LLExpMod2(&c,r,sx[0],x[0],0,e[0],sx[1],x[1],0,e[1]);
+        err+=( (sr!=1) || (r[0]!=1) );
+        CtxLibere(&c);
+    }
+    printf("exponentiations simultanes : %d erreur(s)\n",err);
+    return err;
+}
+
+// dchiffrements masqus successifs de la cl 256_2, le masque tant
+// mis  jour  chaque fois : directs puis par les restes chinois
+int test_masque(void)
+{
+    int sn; mot n[MAX];
+    int se; mot e[4];
+    int sd; mot d[MAX];
+    int sp; mot p[MAX];
+    int sq; mot q[MAX];
+    int sx; mot x[MAX];
+    int sc; mot c[MAX];
+    int sy; mot y[2*MAX];
+    int st; mot t[MAX];
+    ctx_mod ctx;
+    cle_crt k;
+    masque_rsa m;
+    int i;
+    int err;
+
+    sn=AToL(n,"68f4ae1b62792228457af7e8952f63a327cebb7aff6cfe596ee716e5477f7807");
+    se=AToL(e,"10001");
+    sd=AToL(d,"5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699");
+    sp=AToL(p,"883b40de3fb593b22859d915ee2c0a59");
+    sq=AToL(q,"c53a68ca2d12f18d6f5b8f3c00ce895f");
+    sc=AToL(c,"1d436f9f3290e6d0076656cb5a06b024445a2c099134ca4f10d98615a65c0aa4");
+    sx=LFromOctets(x,16,(uint8_t*)"Hello RSA 256_2!");
+    if (CtxInit(&ctx,sn,n)!=0) return 1;
+    if ( (MasqueInit(&ctx,&m,se,e)!=0) || (CRTPrepare(&k,sp,p,sq,q,sd,d)!=0) )
+    {
+        CtxLibere(&ctx);
+        return 1;
+    }
+    err=0;
+    for (i=0;i<4;i++)
+    {
+        sy=LLExpModMasque(&ctx,&m,y,sc,c,sd,d);
+        err+=(LCmp(sy,y,sx,x)!=0);
+    }
+    for (i=0;i<4;i++)
+    {
+        st=sc; LCopy(t,sc,c);
+        st=MasqueApplique(&ctx,&m,st,t);
+        sy=LLExpModCRT(&k,y,st,t);
+        sy=MasqueRetire(&ctx,&m,sy,y);
+        err+=(LCmp(sy,y,sx,x)!=0);
+    }
+    CRTLibere(&k);
+    CtxLibere(&ctx);
+    printf("dchiffrements masqus : %d erreur(s)\n",err);
+    return err;
+}
+
+// magasin de quatre cls crit dans un fichier temporaire puis projet :
+// dchiffrement direct et par les restes chinois de la cl 256_2,
+// chiffrement avec la cl 128_1 qui n'a pas de facteurs ; les deux
+// dernires sont des copies corrompues de la premire, refuses
+int test_stock(void)
+{
+    static cle_stockee k[4];
+    int sn; mot n[MAX];
+    int se; mot e[4];
+    int sd; mot d[MAX];
+    int sp; mot p[MAX];
+    int sq; mot q[MAX];
+    int sx; mot x[MAX];
+    int sc; mot c[MAX];
+    int sy; mot y[2*MAX];
+    stock_rsa s;
+    ctx_mod ctx;
+    cle_crt crt;
+    FILE*f;
+    int err;
+
+    sn=AToL(n,"68f4ae1b62792228457af7e8952f63a327cebb7aff6cfe596ee716e5477f7807");
+    se=AToL(e,"10001");
+    sd=AToL(d,"5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699");
+    sp=AToL(p,"883b40de3fb593b22859d915ee2c0a59");
+    sq=AToL(q,"c53a68ca2d12f18d6f5b8f3c00ce895f");
+    if (StockPrepare(k,sn,n,se,e,sd,d,sp,p,sq,q)!=0) return 1;
+    sn=AToL(n,"70a72c857055e465000cf9ca3d5d4a0f");
+    sd=AToL(d,"21b115e328c83f80be588a636abb3f21");
+    if (StockPrepare(k+1,sn,n,se,e,sd,d,0,NULL,0,NULL)!=0) return 1;
+    k[2]=k[0];
+    k[2].sdp=-5;
+    k[3]=k[0];
+    k[3].pcn.count=LIMB_BITS;
+    f=tmpfile();
+    if (f==NULL) return 1;
+    if ( (StockEcrit(f,4,k)!=0) || (StockOuvreFd(&s,fileno(f))!=0) )
+    {
+        fclose(f);
+        return 1;
+    }
+    fclose(f);
+
+    err=0;
+    // cl 256_2
+    sc=AToL(c,"1d436f9f3290e6d0076656cb5a06b024445a2c099134ca4f10d98615a65c0aa4");
+    sx=LFromOctets(x,16,(uint8_t*)"Hello RSA 256_2!");
+    if (StockCtx(&ctx,StockCle(&s,0))!=0) err++;
+    else
+    {
+        sy=LLExpModCtx(&ctx,y,sc,c,StockCle(&s,0)->sd,StockCle(&s,0)->d);
+        err+=(LCmp(sy,y,sx,x)!=0);
+        CtxLibere(&ctx);
+    }
+    if (StockCRT(&crt,StockCle(&s,0))!=0) err++;
+    else
+    {
+        sy=LLExpModCRT(&crt,y,sc,c);
+        err+=(LCmp(sy,y,sx,x)!=0);
+        CRTLibere(&crt);
+    }
+    // cl 128_1, publique
+    sc=AToL(c,"548af4292204995331ff3c4934d774fb");
+    sx=LFromOctets(x,16,(uint8_t*)"Hello RSA 128_1!");
+    err+=(StockCRT(&crt,StockCle(&s,1))==0);
+    if (StockCtx(&ctx,StockCle(&s,1))!=0) err++;
+    else
+    {
+        sy=LLExpModPub(&ctx,y,sx,x,StockCle(&s,1)->se,StockCle(&s,1)->e);
+        err+=(LCmp(sy,y,sc,c)!=0);
+        CtxLibere(&ctx);
+    }
+    // enregistrements corrompus
+    err+=(StockCle(&s,2)!=NULL);
+    err+=(StockCRT(&crt,s.cles+2)==0);
+    err+=(StockCle(&s,3)!=NULL);
+    err+=(StockCtx(&ctx,s.cles+3)==0);
+    err+=(StockCle(&s,4)!=NULL);
+    printf("magasin de %d cls (%d octets par cl) : %d erreur(s)\n",
+           (int)s.nb,(int)sizeof(cle_stockee),err);
+    StockFerme(&s);
+    return err;
+}
+
+// horloge monotone en nanosecondes
+static double horloge_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec*1e9+ts.tv_nsec;
+}
+
+// temps (ns) d'une multiplication de deux longs de "s" chiffres
+// avec le seuil de Karatsuba "seuil" : meilleure de 7 sries
+static double kara_mesure(int s, int seuil, mot*a, mot*b, mot*r, mot*w)
+{
+    int i,k;
+    int nb;
+    double t;
+    double tmin;
+    kara_seuil=seuil;
+    nb=1+4000000/(s*s);
+    LLMulK(r,s,a,s,b,w); // mise en cache
+    tmin=0;
+    for (k=0;k<7;k++)
+    {
+        t=horloge_ns();
+        for (i=0;i<nb;i++) LLMulK(r,s,a,s,b,w);
+        t=(horloge_ns()-t)/nb;
+        if ( (k==0) || (t<tmin) ) tmin=t;
+    }
+    return tmin;
+}
+
+// recherche du point de croisement entre LLMul et Karatsuba
+// pour chaque taille, on compare la multiplication scolaire  un
+// niveau de Karatsuba ; le seuil conseill est la plus petite taille
+//  partir de laquelle Karatsuba est toujours plus rapide
+#define KARA_BITS_MAX 4096
+void KaraCalibre(void)
+{
+    static int bits[]={128,192,256,384,512,768,1024,1536,2048,3072,4096};
+    static mot a[KARA_BITS_MAX/LIMB_BITS];
+    static mot b[KARA_BITS_MAX/LIMB_BITS];
+    static mot r[2*KARA_BITS_MAX/LIMB_BITS];
+    static mot w[KARA_TEMP(KARA_BITS_MAX/LIMB_BITS)];
+    int i;
+    int s;
+    int seuil;
+    double tl, tk;
+    int sauve;
+
+    sauve=kara_seuil;
+    for (i=0;i<KARA_BITS_MAX/LIMB_BITS;i++)
+    {
+        a[i]=(mot)(0x9e3779b97f4a7c15ull*(i+1));
+        b[i]=(mot)(0xc2b2ae3d27d4eb4full*(i+1));
+    }
+    printf("bits  chiffres  LLMul(ns)  Karatsuba(ns)\n");
+    seuil=INT_MAX;
+    for (i=0;i<(int)(sizeof(bits)/sizeof(bits[0]));i++)
+    {
+        s=bits[i]/LIMB_BITS;
+        if (s<4) continue;
+        tl=kara_mesure(s,INT_MAX,a,b,r,w);
+        tk=kara_mesure(s,s,a,b,r,w);
+        printf("%4d  %8d  %9.0f  %13.0f\n",bits[i],s,tl,tk);
+        if (tk<tl)
+        {
+            if (seuil==INT_MAX) seuil=s;
+        }
+        else seuil=INT_MAX;
+    }
+    if (seuil==INT_MAX) printf("pas de croisement jusqu' %d bits\n",KARA_BITS_MAX);
+    else printf("seuil conseill : -DKARA_SEUIL=%d\n",seuil);
+    kara_seuil=sauve;
+}
+
+/////////////////////////////////////////////////////////
+// banc de mesure
+// "rsa bench [texte|csv|json] [bits_max]"
+// Pour chaque taille de cl, chaque opration est d'abord chauffe et
+// calibre (nombre d'itrations par srie d'au moins 20 us), puis
+// mesure sur une srie d'chantillons dans un budget de temps ; on
+// rend la mdiane et le 99e centile du temps par opration.
+// Tailles 128, 192 et 256 bits : cls de test de main ; au-del, modulo
+// impair et exposant priv pseudo-alatoires de la taille voulue.
+/////////////////////////////////////////////////////////
+
+#define BANC_TEXTE 0
+#define BANC_CSV   1
+#define BANC_JSON  2
+
+#define BANC_ECH_MAX 101        // nombre maxi d'chantillons
+#define BANC_BUDGET  3e8        // budget par mesure (ns)
+
+// oprandes d'une mesure
+typedef struct
+{
+    ctx_mod* c;
+    int sa; mot* a;     // oprande de la taille du modulo
+    int sb; mot* b;     // second oprande
+    int sp; mot* p;     // produit de a et b
+    int se; mot* e;     // exposant
+    mot* r;             // rsultat, 2sn+2 chiffres
+    mot* w;             // zone de travail
+    char* h;            // "a" en hexadcimal
+    masque_rsa* m;      // masque des oprations prives
+    pool_rsa* pool;     // groupe de threads pour les lots
+    int nlot; tache_rsa* lot;
+} banc_arg;
+
+// sortie du banc
+typedef struct
+{
+    int format;
+    int nb;             // nombre de rsultats dj crits
+} banc_sortie;
+
+static uint64_t banc_graine=0x243f6a8885a308d3ull;
+
+// gnrateur pseudo-alatoire xorshift64, reproductible d'un banc  l'autre
+static uint64_t banc_alea(void)
+{
+    banc_graine^=banc_graine<<13;
+    banc_graine^=banc_graine>>7;
+    banc_graine^=banc_graine<<17;
+    return banc_graine;
+}
+
+// long pseudo-alatoire de "s" chiffres, chiffre de poids fort non nul
+static void banc_long(int s, mot*x)
+{
+    int i;
+    for (i=0;i<s;i++) x[i]=(mot)banc_alea();
+    if (x[s-1]==0) x[s-1]=1;
+}
 
-    st=LLExpMod(t,sx,x,se,e);
+static volatile mot banc_puits;   // empche l'limination des calculs
 
+static void banc_smul(banc_arg*g, long nb)
+{
+    mot carry;
+    mot x;
+    long i;
+    carry=0;
+    x=g->a[0];
+    for (i=0;i<nb;i++) x=SMul_a_a(x,g->b[0],x,&carry);
+    banc_puits=x+carry;
+}
 
-    printf("cryptogramme = ");
-    affiche_hexa(st,t);
+static void banc_atol(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) AToL(g->r,g->h);
+}
 
-    // dchiffrement
-    sy=LLExpMod(y,st,t,sd,d);
-    y[sy]=0;
+static void banc_ltohex(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LToHex(g->h,g->sa,g->a);
+}
+
+static void banc_llmul(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LLMul(g->r,g->sa,g->a,g->sb,g->b);
+}
+
+static void banc_llsqr(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LLSqr(g->r,g->sa,g->a);
+}
+
+static void banc_llmulk(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LLMulK(g->r,g->sa,g->a,g->sb,g->b,g->w);
+}
+
+// Modulo travaille sur place : la recopie du produit est comprise
+static void banc_modulo(banc_arg*g, long nb)
+{
+    long i;
+    int sr;
+    for (i=0;i<nb;i++)
+    {
+        LCopy(g->r,g->sp,g->p);
+        sr=g->sp;
+        Modulo(&sr,g->r,g->c->sn,g->c->n);
+    }
+}
+
+static void banc_invmod(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LInvMod(g->r,g->sa,g->a,g->c->sn,g->c->n);
+}
+
+static void banc_llmulmod(banc_arg*g, long nb)
+{
+    long i;
+    LCopy(g->r,g->sa,g->a);
+    for (i=0;i<nb;i++) LLMulMod(g->c,g->sa,g->r,g->sb,g->b);
+}
+
+static void banc_expmod(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LLExpMod(g->c,g->r,g->sa,g->a,g->se,g->e);
+}
+
+static void banc_expmodpub(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LLExpModPub(g->c,g->r,g->sa,g->a,g->se,g->e);
+}
+
+static void banc_expmodmasque(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LLExpModMasque(g->c,g->m,g->r,g->sa,g->a,g->se,g->e);
+}
+
+static void banc_expmodfen(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LLExpModFen(g->c,g->r,g->sa,g->a,g->se,g->e);
+}
+
+static void banc_expmodmont(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LLExpModMont(g->c,g->r,g->sa,g->a,g->se,g->e);
+}
+
+// 8 messages par opration, noyau SIMD le plus large disponible
+static void banc_multi(banc_arg*g, long nb)
+{
+    static mot r[8][MAX];
+    mot*pr[8]; mot*px[8];
+    int sr[8], sx[8];
+    long i;
+    for (i=0;i<8;i++)
+    {
+        pr[i]=r[i];
+        px[i]=g->a;
+        sx[i]=g->sa;
+    }
+    for (i=0;i<nb;i++) LLExpModMulti(g->c,0,8,pr,sr,sx,px,g->se,g->e);
+}
+
+// x^d.y^d simultan, et le mme produit par deux exponentiations
+static void banc_expmod2(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) LLExpMod2(g->c,g->r,g->sa,g->a,g->se,g->e,g->sb,g->b,g->se,g->e);
+}
+
+static void banc_expmod2sep(banc_arg*g, long nb)
+{
+    long i;
+    int s1, s2;
+    for (i=0;i<nb;i++)
+    {
+        s1=LLExpModMont(g->c,g->r,g->sa,g->a,g->se,g->e);
+        s2=LLExpModMont(g->c,g->r+g->c->sn,g->sb,g->b,g->se,g->e);
+        LLMulMod(g->c,s1,g->r,s2,g->r+g->c->sn);
+    }
+}
+
+static void banc_lot(banc_arg*g, long nb)
+{
+    long i;
+    for (i=0;i<nb;i++) PoolLot(g->pool,g->lot,g->nlot);
+}
+
+static int banc_compare(const void*a, const void*b)
+{
+    double x=*(const double*)a;
+    double y=*(const double*)b;
+    return (x>y)-(x<y);
+}
+
+// mesure d'une opration et criture du rsultat
+static void banc_mesure(banc_sortie*s, const char*nom, int bits,
+                        void (*op)(banc_arg*,long), banc_arg*g)
+{
+    double ech[BANC_ECH_MAX];
+    double t;
+    long nb;
+    int nech;
+    int i;
+    double med, p99;
+
+    // chauffe et calibrage : au moins 20 us par chantillon
+    nb=1;
+    for (;;)
+    {
+        t=horloge_ns();
+        op(g,nb);
+        t=horloge_ns()-t;
+        if ( (t>=2e4) || (nb>=(1L<<30)) ) break;
+        nb*=2;
+    }
+    nech=(int)(BANC_BUDGET/t);
+    if (nech<5) nech=5;
+    if (nech>BANC_ECH_MAX) nech=BANC_ECH_MAX;
+    for (i=0;i<nech;i++)
+    {
+        t=horloge_ns();
+        op(g,nb);
+        ech[i]=(horloge_ns()-t)/nb;
+    }
+    qsort(ech,nech,sizeof(double),banc_compare);
+    med=ech[nech/2];
+    p99=ech[(nech*99)/100 < nech ? (nech*99)/100 : nech-1];
+    switch (s->format)
+    {
+    case BANC_CSV:
+        printf("%s,%d,%d,%d,%ld,%.1f,%.1f,%.0f\n",
+               nom,bits,LIMB_BITS,nech,nb,med,p99,1e9/med);
+        break;
+    case BANC_JSON:
+        printf("%s\n    {\"operation\":\"%s\",\"bits\":%d,\"echantillons\":%d,"
+               "\"iterations\":%ld,\"mediane_ns\":%.1f,\"p99_ns\":%.1f,"
+               "\"ops_s\":%.0f}",
+               s->nb ? "," : "",nom,bits,nech,nb,med,p99,1e9/med);
+        break;
+    default:
+        printf("%-20s %5d %14.1f %14.1f %14.0f\n",nom,bits,med,p99,1e9/med);
+    }
+    s->nb++;
+    fflush(stdout);
+}
+
+// lots de BANC_LOT exponentiations prives, sur un thread puis sur
+// autant de threads que de processeurs en ligne
+#define BANC_LOT 32
+static void banc_lots(banc_sortie*s, int bits, banc_arg*g)
+{
+    static mot r[BANC_LOT][MAX];
+    tache_rsa t[BANC_LOT];
+    pool_rsa p;
+    char nom[32];
+    long ncpu;
+    int nth;
+    int i;
+
+    for (i=0;i<BANC_LOT;i++)
+    {
+        t[i].sn=g->c->sn; t[i].n=g->c->n;
+        t[i].se=g->se; t[i].e=g->e;
+        t[i].sx=g->sa; t[i].x=g->a;
+        t[i].r=r[i];
+    }
+    g->lot=t;
+    g->nlot=BANC_LOT;
+    ncpu=sysconf(_SC_NPROCESSORS_ONLN);
+    for (nth=1;;nth=(int)ncpu)
+    {
+        if (PoolCree(&p,nth)!=0) return;
+        g->pool=&p;
+        snprintf(nom,sizeof(nom),"PoolLot%d_%dt",BANC_LOT,nth);
+        banc_mesure(s,nom,bits,banc_lot,g);
+        PoolDetruit(&p);
+        if (nth>=ncpu) break;
+    }
+}
+
+// toutes les mesures pour un modulo de "bits" bits
+// "hn" et "hd" : modulo et exposant priv en hexadcimal, ou NULL
+static void banc_taille(banc_sortie*s, int bits, char*hn, char*hd)
+{
+    static mot n[MAX];
+    static mot d[MAX];
+    static mot a[MAX];
+    static mot b[MAX];
+    static mot p[2*MAX];
+    static mot r[2*MAX+2];
+    static mot w[KARA_TEMP(MAX)];
+    static char h[2*MAX_OCTETS+1];
+    mot e[2];
+    int sn, sd;
+    ctx_mod c;
+    masque_rsa m;
+    mont_fixe mf;
+    banc_arg g;
+
+    if (hn!=NULL)
+    {
+        sn=AToL(n,hn);
+        sd=AToL(d,hd);
+    }
+    else
+    {   // modulo impair de "bits" bits, exposant priv de mme taille
+        sn=(bits+LIMB_BITS-1)/LIMB_BITS;
+        banc_long(sn,n);
+        n[sn-1]|=MOT_HAUT;
+        n[0]|=1;
+        sd=sn;
+        banc_long(sd,d);
+        d[sd-1]&=~MOT_HAUT;
+    }
+    if (CtxInit(&c,sn,n)!=0) return;
+    // oprandes infrieurs  n
+    banc_long(sn,a);
+    a[sn-1]=n[sn-1]>>1;
+    banc_long(sn,b);
+    b[sn-1]=n[sn-1]>>1;
+    g.c=&c;
+    g.sa=sn; g.a=a;
+    g.sb=sn; g.b=b;
+    g.sp=LLMul(p,sn,a,sn,b); g.p=p;
+    g.r=r;
+    g.w=w;
+    g.h=h;
+    LToHex(h,sn,a);
+
+    banc_mesure(s,"SMul_a_a",bits,banc_smul,&g);
+    banc_mesure(s,"AToL",bits,banc_atol,&g);
+    banc_mesure(s,"LToHex",bits,banc_ltohex,&g);
+    banc_mesure(s,"LLMul",bits,banc_llmul,&g);
+    banc_mesure(s,"LLSqr",bits,banc_llsqr,&g);
+    banc_mesure(s,"LLMulK",bits,banc_llmulk,&g);
+    banc_mesure(s,"Modulo",bits,banc_modulo,&g);
+    banc_mesure(s,"LInvMod",bits,banc_invmod,&g);
+    banc_mesure(s,"LLMulMod",bits,banc_llmulmod,&g);
+    CtxReduction(&c,RED_BARRETT);
+    banc_mesure(s,"LLMulMod_barrett",bits,banc_llmulmod,&g);
+    CtxReduction(&c,RED_DIVISION);
+    // exposant public 65537
+    g.se=AToL(e,"10001"); g.e=e;
+    banc_mesure(s,"LLExpMod_public",bits,banc_expmod,&g);
+    banc_mesure(s,"LLExpModMont_public",bits,banc_expmodmont,&g);
+    banc_mesure(s,"LLExpModPub_public",bits,banc_expmodpub,&g);
+    // exposant priv
+    g.se=sd; g.e=d;
+    banc_mesure(s,"LLExpMod_prive",bits,banc_expmod,&g);
+    banc_mesure(s,"LLExpModFen_prive",bits,banc_expmodfen,&g);
+    CtxReduction(&c,RED_BARRETT);
+    banc_mesure(s,"LLExpModFen_barrett",bits,banc_expmodfen,&g);
+    CtxReduction(&c,RED_DIVISION);
+    banc_mesure(s,"LLExpModMont_prive",bits,banc_expmodmont,&g);
+    if (MasqueInit(&c,&m,AToL(e,"10001"),e)==0)
+    {   // masque avec e = 65537, mmes exposant et rduction que LLExpModCtx
+        g.m=&m;
+        CtxReduction(&c,RED_MONTGOMERY);
+        banc_mesure(s,"LLExpModMasque_prive",bits,banc_expmodmasque,&g);
+        CtxReduction(&c,RED_DIVISION);
+    }
+    banc_mesure(s,"LLExpModMulti8_prive",bits,banc_multi,&g);
+    banc_mesure(s,"LLExpMod2_prive",bits,banc_expmod2,&g);
+    banc_mesure(s,"LLExpModMont2x_prive",bits,banc_expmod2sep,&g);
+    mf=c.mf;
+    if (mf!=NULL)
+    {   // produit de taille variable (noyau LMulAdd), pour comparaison
+        c.mf=NULL;
+        banc_mesure(s,"LLExpModMont_var",bits,banc_expmodmont,&g);
+        c.mf=mf;
+    }
+    if (NoyauAdx(1))
+    {   // mmes oprations avec le noyau C, pour comparaison ; sans le
+        // produit de taille fixe, qui n'utilise pas le noyau
+        NoyauAdx(0);
+        c.mf=NULL;
+        banc_mesure(s,"LLMul_c",bits,banc_llmul,&g);
+        banc_mesure(s,"LLSqr_c",bits,banc_llsqr,&g);
+        banc_mesure(s,"LLExpModMont_prive_c",bits,banc_expmodmont,&g);
+        c.mf=mf;
+        NoyauAdx(1);
+    }
+    banc_lots(s,bits,&g);
+    CtxLibere(&c);
+}
+
+// banc complet jusqu' "bits_max" bits
+void Banc(int format, int bits_max)
+{
+    static int grands[]={512,1024,2048,3072,4096};
+    banc_sortie s;
+    int i;
+
+    s.format=format;
+    s.nb=0;
+    switch (format)
+    {
+    case BANC_CSV:
+        printf("operation,bits,limb_bits,echantillons,iterations,mediane_ns,p99_ns,ops_s\n");
+        break;
+    case BANC_JSON:
+        printf("{\"limb_bits\":%d,\"kara_seuil\":%d,\"resultats\":[",LIMB_BITS,kara_seuil);
+        break;
+    default:
+        printf("LIMB_BITS=%d KARA_SEUIL=%d\n",LIMB_BITS,kara_seuil);
+        printf("%-20s %5s %14s %14s %14s\n","operation","bits","mediane(ns)","p99(ns)","ops/s");
+    }
+    banc_taille(&s,128,"70a72c857055e465000cf9ca3d5d4a0f",
+                       "21b115e328c83f80be588a636abb3f21");
+    banc_taille(&s,192,"89285e3254d3c85e712db22cd324994c702a50360d8de3a7",
+                       "16dc0fb30e234c0fbd879db1ddc4dba8d6659dbc8bf68443");
+    banc_taille(&s,256,"68f4ae1b62792228457af7e8952f63a327cebb7aff6cfe596ee716e5477f7807",
+                       "5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699");
+    for (i=0;i<(int)(sizeof(grands)/sizeof(grands[0]));i++)
+    {
+        if ( (grands[i]<=bits_max) && (grands[i]<=MAX_BITS) )
+        {
+            banc_taille(&s,grands[i],NULL,NULL);
+        }
+    }
+    if (format==BANC_JSON) printf("\n]}\n");
+}
+
+/////////////////////////////////////////////////////////
+// chiffrement et dchiffrement de fichiers
+// Le fichier clair est dcoup en blocs de k-1 octets (k = taille de n
+// en octets), le dernier complt par des zros ; chaque bloc, lu comme
+// un entier big endian, donne un bloc chiffr de k octets. Le fichier
+// chiffr commence par la longueur du clair sur 8 octets big endian.
+// Trois tages : le thread appelant lit des lots de FICHIER_BLOCS
+// blocs, des ouvriers les chiffrent (chacun avec son contexte, en
+// Montgomery, chane fixe pour e = 3 ou 65537), un thread crivain les
+// crit dans l'ordre. Les lots circulent dans un anneau de FICHIER_LOTS
+// emplacements : la mmoire utilise ne dpend pas de la taille du
+// fichier.
+/////////////////////////////////////////////////////////
+
+#define FICHIER_BLOCS 64
+#define FICHIER_LOTS  16
+
+#define LOT_LIBRE   0
+#define LOT_PLEIN   1       // lu,  calculer
+#define LOT_CALCULE 2       // calcul,  crire
+
+typedef struct
+{
+    int etat;
+    int nb;                 // nombre de blocs du lot
+    int erreur;
+    uint8_t* entree;        // FICHIER_BLOCS blocs d'entre
+    uint8_t* sortie;        // FICHIER_BLOCS blocs de sortie
+} lot_fichier;
+
+typedef struct
+{
+    pthread_mutex_t m;
+    pthread_cond_t cv;      // tout changement d'tat
+    lot_fichier lots[FICHIER_LOTS];
+    long lus;               // lots lus
+    long pris;              // lots pris par les ouvriers
+    int fin;                // lecture termine
+    int erreur;
+    // paramtres
+    int sn; mot*n;
+    int se; mot*e;
+    int ke, ks;             // tailles des blocs d'entre et de sortie
+    uint64_t reste;         // octets restant  crire (dchiffrement)
+    int dechiffre;
+    FILE* fs;
+} tube_fichier;
+
+static void* FichierOuvrier(void*arg)
+{
+    tube_fichier*t=arg;
+    lot_fichier*l;
+    ctx_mod c;
+    mot x[MAX];
+    mot y[MAX];
+    int sx, sy;
+    int i;
+    long k;
+
+    if (CtxInit(&c,t->sn,t->n)!=0)
+    {
+        pthread_mutex_lock(&t->m);
+        t->erreur=1;
+        pthread_cond_broadcast(&t->cv);
+        pthread_mutex_unlock(&t->m);
+        return NULL;
+    }
+    CtxReduction(&c,RED_MONTGOMERY);
+    for (;;)
+    {
+        pthread_mutex_lock(&t->m);
+        while ( (t->pris==t->lus) && !t->fin && !t->erreur ) pthread_cond_wait(&t->cv,&t->m);
+        if ( (t->pris==t->lus) || t->erreur )
+        {
+            pthread_mutex_unlock(&t->m);
+            break;
+        }
+        k=t->pris++;
+        pthread_mutex_unlock(&t->m);
+
+        l=t->lots+k%FICHIER_LOTS;
+        l->erreur=0;
+        for (i=0;i<l->nb;i++)
+        {
+            sx=LFromOctetsBE(x,t->ke,l->entree+(size_t)i*t->ke);
+            if (LCmp(sx,x,c.sn,c.n)>=0)
+            {   // bloc chiffr suprieur au modulo
+                l->erreur=1;
+                break;
+            }
+            sy=LLExpModPub(&c,y,sx,x,t->se,t->e);
+            if (LToOctetsBE(l->sortie+(size_t)i*t->ks,t->ks,sy,y)<0)
+            {   // clair plus long que k-1 octets : mauvaise cl
+                l->erreur=1;
+                break;
+            }
+        }
+        pthread_mutex_lock(&t->m);
+        l->etat=LOT_CALCULE;
+        pthread_cond_broadcast(&t->cv);
+        pthread_mutex_unlock(&t->m);
+    }
+    CtxLibere(&c);
+    return NULL;
+}
+
+static void* FichierEcrivain(void*arg)
+{
+    tube_fichier*t=arg;
+    lot_fichier*l;
+    size_t nb;
+    long k;
+    int err;
+
+    for (k=0;;k++)
+    {
+        l=t->lots+k%FICHIER_LOTS;
+        pthread_mutex_lock(&t->m);
+        while ( (l->etat!=LOT_CALCULE) && !(t->fin && (k==t->lus)) && !t->erreur )
+        {
+            pthread_cond_wait(&t->cv,&t->m);
+        }
+        if ( (l->etat!=LOT_CALCULE) || t->erreur )
+        {
+            pthread_mutex_unlock(&t->m);
+            break;
+        }
+        pthread_mutex_unlock(&t->m);
+
+        nb=(size_t)l->nb*t->ks;
+        if ( t->dechiffre && (nb>t->reste) ) nb=t->reste;
+        err= l->erreur || (fwrite(l->sortie,1,nb,t->fs)!=nb);
+        t->reste-=nb;
+
+        pthread_mutex_lock(&t->m);
+        l->etat=LOT_LIBRE;
+        if (err) t->erreur=1;
+        pthread_cond_broadcast(&t->cv);
+        pthread_mutex_unlock(&t->m);
+    }
+    return NULL;
+}
+
+// chiffrement (dechiffre = 0) ou dchiffrement de "fe" dans "fs"
+// avec le modulo "n" et l'exposant "e" sur "nth" threads de calcul
+// "fe" doit permettre fseeko (la longueur du clair est crite en tte)
+// rend 0 ou -1 ; affiche le dbit
+int FichierRSA(int dechiffre, int sn, mot*n, int se, mot*e,
+               FILE*fe, FILE*fs, int nth)
+{
+    tube_fichier t;
+    pthread_t th[FICHIER_LOTS];
+    pthread_t ecrivain;
+    int ecrit;          // le thread crivain est lanc
+    int err;
+    lot_fichier*l;
+    uint8_t lg[8];
+    uint64_t taille;
+    uint64_t lu;
+    off_t debut;
+    size_t nl;
+    double t0;
+    int nbth;
+    int i;
+    int k;
+
+    k=(LBits(sn,n)+7)/8;
+    if (k<2) return -1;
+    if (nth<1) nth=1;
+    if (nth>FICHIER_LOTS-2) nth=FICHIER_LOTS-2;
+    t0=horloge_ns();
+    if (dechiffre)
+    {
+        if (fread(lg,1,8,fe)!=8) return -1;
+        taille=0;
+        for (i=0;i<8;i++) taille=(taille<<8)|lg[i];
+    }
+    else
+    {   // longueur du clair
+        debut=ftello(fe);
+        if ( (debut<0) || (fseeko(fe,0,SEEK_END)!=0) ) return -1;
+        taille=ftello(fe)-debut;
+        if (fseeko(fe,debut,SEEK_SET)!=0) return -1;
+        for (i=0;i<8;i++) lg[i]=taille>>(56-8*i);
+        if (fwrite(lg,1,8,fs)!=8) return -1;
+    }
+
+    memset(&t,0,sizeof(t));
+    t.sn=sn; t.n=n;
+    t.se=se; t.e=e;
+    t.ke= dechiffre ? k : k-1;
+    t.ks= dechiffre ? k-1 : k;
+    t.reste=taille;
+    t.dechiffre=dechiffre;
+    t.fs=fs;
+    for (i=0;i<FICHIER_LOTS;i++)
+    {
+        t.lots[i].entree=malloc((size_t)FICHIER_BLOCS*(t.ke+t.ks));
+        t.lots[i].sortie=t.lots[i].entree+(size_t)FICHIER_BLOCS*t.ke;
+        if (t.lots[i].entree==NULL) t.erreur=1;
+    }
+    pthread_mutex_init(&t.m,NULL);
+    pthread_cond_init(&t.cv,NULL);
+    nbth=0;
+    ecrit=0;
+    if (!t.erreur)
+    {
+        for (nbth=0;nbth<nth;nbth++)
+        {
+            if (pthread_create(th+nbth,NULL,FichierOuvrier,&t)!=0) break;
+        }
+        ecrit=(pthread_create(&ecrivain,NULL,FichierEcrivain,&t)==0);
+        if ( (nbth==0) || !ecrit ) t.erreur=1;
+    }
+
+    // lecture
+    lu=0;
+    err=0;
+    for (;;)
+    {
+        l=t.lots+t.lus%FICHIER_LOTS;
+        pthread_mutex_lock(&t.m);
+        while ( (l->etat!=LOT_LIBRE) && !t.erreur ) pthread_cond_wait(&t.cv,&t.m);
+        err=t.erreur;
+        pthread_mutex_unlock(&t.m);
+        if (err) break;
+        nl=fread(l->entree,1,(size_t)FICHIER_BLOCS*t.ke,fe);
+        if ( (nl==0) || (dechiffre && (nl%t.ke!=0)) )
+        {   // fin de fichier, ou fichier chiffr tronqu
+            err=(nl!=0) || ferror(fe);
+            break;
+        }
+        lu+=nl;
+        l->nb=(nl+t.ke-1)/t.ke;
+        // dernier bloc complt par des zros
+        memset(l->entree+nl,0,(size_t)l->nb*t.ke-nl);
+        pthread_mutex_lock(&t.m);
+        l->etat=LOT_PLEIN;
+        t.lus++;
+        pthread_cond_broadcast(&t.cv);
+        pthread_mutex_unlock(&t.m);
+    }
+    pthread_mutex_lock(&t.m);
+    t.fin=1;
+    if (err) t.erreur=1;
+    pthread_cond_broadcast(&t.cv);
+    pthread_mutex_unlock(&t.m);
+
+    for (i=0;i<nbth;i++) pthread_join(th[i],NULL);
+    if (ecrit) pthread_join(ecrivain,NULL);
+    pthread_mutex_destroy(&t.m);
+    pthread_cond_destroy(&t.cv);
+    for (i=0;i<FICHIER_LOTS;i++) free(t.lots[i].entree);
+    if ( dechiffre && (t.reste!=0) ) t.erreur=1;
+    if ( t.erreur || (fflush(fs)!=0) ) return -1;
+    t0=horloge_ns()-t0;
+    printf("%" PRIu64 " octets en %.3f s, %.2f Mo/s (%d threads)\n",
+           lu,t0*1e-9,lu/(t0*1e-3),nbth);
+    return 0;
+}
+
+// chiffrement puis dchiffrement d'un fichier temporaire de quelques
+// lots, dernier bloc incomplet, avec la cl 256_2
+int test_fichier(void)
+{
+    enum { TAILLE=FICHIER_BLOCS*31*3+17 };
+    static uint8_t clair[TAILLE];
+    static uint8_t relu[TAILLE+1];
+    int sn; mot n[MAX];
+    int se; mot e[4];
+    int sd; mot d[MAX];
+    FILE*f[3];
+    int i;
+    int err;
+
+    sn=AToL(n,"68f4ae1b62792228457af7e8952f63a327cebb7aff6cfe596ee716e5477f7807");
+    se=AToL(e,"10001");
+    sd=AToL(d,"5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699");
+    for (i=0;i<TAILLE;i++) clair[i]=banc_alea();
+    for (i=0;i<3;i++) f[i]=tmpfile();
+    err=1;
+    if ( (f[0]!=NULL) && (f[1]!=NULL) && (f[2]!=NULL)
+      && (fwrite(clair,1,TAILLE,f[0])==TAILLE) )
+    {
+        rewind(f[0]);
+        if ( (FichierRSA(0,sn,n,se,e,f[0],f[1],3)==0)
+          && (rewind(f[1]),FichierRSA(1,sn,n,sd,d,f[1],f[2],3)==0) )
+        {
+            rewind(f[2]);
+            err=(fread(relu,1,TAILLE+1,f[2])!=TAILLE) || (memcmp(clair,relu,TAILLE)!=0);
+        }
+    }
+    for (i=0;i<3;i++) if (f[i]!=NULL) fclose(f[i]);
+    return err;
+}
+
+// inverses modulaires de longs pseudo-alatoires de 2  MAX/2 chiffres,
+// vrifis par a.r mod m = 1 ; pgcd diffrent de 1 sinon
+int test_inverse(void)
+{
+    static mot a[MAX], m[MAX], r[MAX+2], g[MAX+2], p[2*MAX+2];
+    int sa, sm, sr, sg, sp;
+    int i;
+    int err;
+
+    err=0;
+    for (i=0;i<200;i++)
+    {
+        sm=2+(int)(banc_alea()%(MAX/2-1));
+        banc_long(sm,m);
+        sa=1+(int)(banc_alea()%sm);
+        banc_long(sa,a);
+        if (sa==sm) a[sa-1]=m[sm-1]>>1;
+        while ( (sa>0) && (a[sa-1]==0) ) sa--;
+        if (sa==0) continue;
+        sr=LInvMod(r,sa,a,sm,m);
+        sg=LPgcd(g,sa,a,sm,m);
+        if (sr<0)
+        {
+            err+=( (sg==1) && (g[0]==1) );
+            continue;
+        }
+        sp=LLMul(p,sa,a,sr,r);
+        Modulo(&sp,p,sm,m);
+        err+=( (sp!=1) || (p[0]!=1) || (sg!=1) || (g[0]!=1) );
+    }
+    printf("inverses modulaires : %d erreur(s)\n",err);
+    return err;
+}
+
+// inverse modulaire compar  l'exposant priv de la cl 256_2, puis
+// gnration d'une cl de 512 bits sur deux threads : chiffrement et
+// dchiffrement direct et par les restes chinois
+int test_genere(void)
+{
+    static cle_stockee k;
+    int sp; mot p[MAX];
+    int sq; mot q[MAX];
+    int sd; mot d[MAX];
+    int se; mot e[4];
+    int sl; mot l[2*MAX];
+    int sx; mot x[MAX];
+    int sc; mot c[MAX];
+    int sy; mot y[2*MAX];
+    mot un=1;
+    gen_rsa* g;
+    ctx_mod ctx;
+    cle_crt crt;
+    int err;
+
+    se=AToL(e,"10001");
+    sd=AToL(d,"5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699");
+    sp=AToL(p,"883b40de3fb593b22859d915ee2c0a59");
+    sq=AToL(q,"c53a68ca2d12f18d6f5b8f3c00ce895f");
+    sp=LSub(p,sp,p,1,&un);
+    sq=LSub(q,sq,q,1,&un);
+    sl=LPpcm(l,sp,p,sq,q);
+    sy=LInvMod(y,se,e,sl,l);
+    err=(LCmp(sy,y,sd,d)!=0);
+    err+=(LInvMod(y,sp,p,sl,l)>=0);     // p-1 divise ppcm(p-1,q-1)
+
+    g=malloc(sizeof(gen_rsa));
+    if ( (g==NULL) || (GenCree(g,2)!=0) )
+    {
+        free(g);
+        return 1;
+    }
+    if (GenCle(g,512,se,e,&k)!=0) err++;
+    else
+    {
+        err+=(LBits(k.sn,k.n)!=512);
+        sx=LFromOctets(x,16,(uint8_t*)"Hello RSA 512_g!");
+        if (StockCtx(&ctx,&k)!=0) err++;
+        else
+        {
+            sc=LLExpModPub(&ctx,c,sx,x,k.se,k.e);
+            sy=LLExpModCtx(&ctx,y,sc,c,k.sd,k.d);
+            err+=(LCmp(sy,y,sx,x)!=0);
+            CtxLibere(&ctx);
+            if (StockCRT(&crt,&k)!=0) err++;
+            else
+            {
+                sy=LLExpModCRT(&crt,y,sc,c);
+                err+=(LCmp(sy,y,sx,x)!=0);
+                CRTLibere(&crt);
+            }
+        }
+        printf("cl gnre n = ");
+        affiche_hexa(k.sn,k.n);
+    }
+    GenDetruit(g);
+    free(g);
+    printf("gnration de cls : %d erreur(s)\n",err);
+    return err;
+}
+
+// commande "rsa chiffre|dechiffre n exposant entre sortie [threads]"
+// "n" et l'exposant en hexadcimal
+static int commande_fichier(int argc, char**argv)
+{
+    mot n[MAX];
+    mot e[MAX];
+    int sn, se;
+    FILE*fe;
+    FILE*fs;
+    int r;
 
-    printf("message = %s\n",y); 
-    return strcmp(m,(char*)y);
+    if ( (argc<6) || (strlen(argv[2])>2*MAX_OCTETS) || (strlen(argv[3])>2*MAX_OCTETS) )
+    {
+        printf("usage : rsa chiffre|dechiffre n exposant entre sortie [threads]\n");
+        return 1;
+    }
+    sn=AToL(n,argv[2]);
+    se=AToL(e,argv[3]);
+    fe=fopen(argv[4],"rb");
+    if (fe==NULL)
+    {
+        printf("%s illisible\n",argv[4]);
+        return 1;
+    }
+    fs=fopen(argv[5],"wb");
+    if (fs==NULL)
+    {
+        printf("%s : criture impossible\n",argv[5]);
+        fclose(fe);
+        return 1;
+    }
+    r=FichierRSA(strcmp(argv[1],"dechiffre")==0,sn,n,se,e,fe,fs,
+                 argc>6 ? atoi(argv[6]) : (int)sysconf(_SC_NPROCESSORS_ONLN));
+    fclose(fe);
+    if (fclose(fs)!=0) r=-1;
+    if (r!=0) printf("erreur de %s\n",argv[1]);
+    return r!=0;
+}
 
+// commande "rsa genere [bits [nombre [magasin]]]"
+// gnre "nombre" cls de "bits" bits (e = 65537) et affiche le nombre
+// de cls par seconde ; sans taille, mesure en 512, 1024 et 2048 bits
+// les cls sont crites dans le magasin "magasin" s'il est donn
+static int commande_genere(int argc, char**argv)
+{
+    static int tailles[]={512,1024,2048};
+    int se; mot e[4];
+    int bits;
+    int nb;
+    int nth;
+    int i, j;
+    int err;
+    double t;
+    cle_stockee*k;
+    gen_rsa*g;
+    FILE*f;
 
+    se=AToL(e,"10001");
+    bits= argc>2 ? atoi(argv[2]) : 0;
+    nb= argc>3 ? atoi(argv[3]) : 4;
+    if ( (nb<1) || ( (bits!=0) && ( (bits<GEN_BITS_MIN) || (bits>MAX_BITS) ) ) )
+    {
+        printf("usage : rsa genere [bits [nombre [magasin]]], %d <= bits <= %d\n",
+               GEN_BITS_MIN,MAX_BITS);
+        return 1;
+    }
+    nth=(int)sysconf(_SC_NPROCESSORS_ONLN);
+    k=malloc(nb*sizeof(cle_stockee));
+    g=malloc(sizeof(gen_rsa));
+    if ( (k==NULL) || (g==NULL) || (GenCree(g,nth)!=0) )
+    {
+        free(k);
+        free(g);
+        return 1;
+    }
+    err=0;
+    for (j=0;j<(int)(sizeof(tailles)/sizeof(tailles[0]));j++)
+    {
+        if (bits==0)
+        {
+            if (tailles[j]>MAX_BITS) break;
+        }
+        else if (j>0) break;
+        t=horloge_ns();
+        for (i=0;(i<nb)&&(err==0);i++)
+        {
+            err=GenCle(g, bits ? bits : tailles[j],se,e,k+i);
+        }
+        t=horloge_ns()-t;
+        if (err!=0) break;
+        printf("%5d bits : %d cls en %.3f s, %.2f cls/s (%d threads)\n",
+               bits ? bits : tailles[j],nb,t*1e-9,nb/(t*1e-9),g->nth);
+    }
+    GenDetruit(g);
+    free(g);
+    if ( (err==0) && (bits!=0) && (argc>4) )
+    {
+        f=fopen(argv[4],"wb");
+        if (f==NULL) err=-1;
+        else
+        {
+            err=StockEcrit(f,nb,k);
+            if (fclose(f)!=0) err=-1;
+        }
+    }
+    free(k);
+    if (err!=0) printf("erreur de gnration\n");
+    return err!=0;
 }
 
-int main()
+// sans argument : tests de chiffrement et de dchiffrement
+// "rsa bench [texte|csv|json] [bits_max]" : banc de mesure
+// "rsa kara" : recherche du seuil de Karatsuba
+// "rsa chiffre|dechiffre n exposant entre sortie [threads]" : fichiers
+// "rsa genere [bits [nombre [magasin]]]" : gnration de cls
+int main(int argc, char**argv)
 {
+    int format;
+    if ( (argc>1) && ( (strcmp(argv[1],"chiffre")==0) || (strcmp(argv[1],"dechiffre")==0) ) )
+    {
+        return commande_fichier(argc,argv);
+    }
+    if ( (argc>1) && (strcmp(argv[1],"genere")==0) )
+    {
+        return commande_genere(argc,argv);
+    }
+    if ( (argc>1) && (strcmp(argv[1],"kara")==0) )
+    {
+        KaraCalibre();
+        return 0;
+    }
+    if ( (argc>1) && (strcmp(argv[1],"bench")==0) )
+    {
+        format=BANC_TEXTE;
+        if (argc>2)
+        {
+            if (strcmp(argv[2],"csv")==0) format=BANC_CSV;
+            if (strcmp(argv[2],"json")==0) format=BANC_JSON;
+        }
+        Banc(format, argc>3 ? atoi(argv[3]) : 2048);
+        return 0;
+    }
     printf("Hello RSA!\n");
     int r;
 
     r=test_rsa( "70a72c857055e465000cf9ca3d5d4a0f",
                 "21b115e328c83f80be588a636abb3f21",
                 "10001",
-                "Hello RSA 128_1!");
+                "Hello RSA 128_1!",
+                "548af4292204995331ff3c4934d774fb");
     printf("%s\n\n",r==0?"OK":"!!");
 
     r=test_rsa( "70a72c857055e48268459dcb198b71f1",
                 "4b1a1dae4ae3edab5b121efddb07beb",
                 "3",
-                "Hello RSA 128_2!");
+                "Hello RSA 128_2!",
+                "0ff06c390e1b1de553ebdf58ab06ea6b");
     printf("%s\n\n",r==0?"OK":"!!");
 
 
     r=test_rsa( "89285e3254d3c85e712db22cd324994c702a50360d8de3a7",
                 "16dc0fb30e234c0fbd879db1ddc4dba8d6659dbc8bf68443",
                 "3",
-                "Hello RSA 192_1!");
+                "Hello RSA 192_1!",
+                "2888cd2cd87c01531f7f187737d960c0f2bca6c64f918872");
     printf("%s\n\n",r==0?"OK":"!!");
     r=test_rsa( "84a288acefd19ae29412bb4f2fc2cffa666e8fd275aff0d58c2f907418140719",
                 "586c5b1df5366741b80c7cdf752c8aa5f51be3f7a9612eb0ea96f2d5da0d77b",
                 "3",
-                "Hello RSA 256_1!");
+                "Hello RSA 256_1!",
+                "57413ff763beffe38754ef640895feb3533ae32b35abdf86c322ee79f486bc");
     printf("%s\n\n",r==0?"OK":"!!");
 
 
     r=test_rsa( "68f4ae1b62792228457af7e8952f63a327cebb7aff6cfe596ee716e5477f7807",
                 "5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699",
                 "10001",
-                "Hello RSA 256_2!");
+                "Hello RSA 256_2!",
+                "1d436f9f3290e6d0076656cb5a06b024445a2c099134ca4f10d98615a65c0aa4");
     printf("%s\n\n",r==0?"OK":"!!");
 
 
     r=test_rsa( "13cfc485d4a8394cbcaf6030156499ca7b340b1bbc2fddc6ad9c870210006d3b",
                 "2f2eb22ac8bb9b3b56639600edf21910918a886bd8738bb5e8dcf2479d46b31",
                 "10001",
-                "Hello RSA 256_3!");
+                "Hello RSA 256_3!",
+                "10e81d4886753abb085b25c5669952b9bfefb12050f1d5ff74b55efa50c14dbf");
     printf("%s\n\n",r==0?"OK":"!!");
 
 
     r=test_rsa( "6918c6a6af78ff0731e47076993c8eb353273e9b807df03886dede7dc77c6aaf",
                 "13e91db97684f5cbe727e02697e161275709fb381dec5854d8c92a55d56ed01",
                 "10001",
-                "Hello RSA 256_4!");
+                "Hello RSA 256_4!",
+                "325b449d5f1ccc715212e500e2a5bd0bffa93ac430dc63f7b6a69de643d2c597");
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    // dchiffrement par les restes chinois, facteurs lists dans puk.c
+    // (seule la premire factorisation de la liste donne bien n)
+    r=test_crt( "68f4ae1b62792228457af7e8952f63a327cebb7aff6cfe596ee716e5477f7807",
+                "5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699",
+                "883b40de3fb593b22859d915ee2c0a59",
+                "c53a68ca2d12f18d6f5b8f3c00ce895f",
+                "Hello RSA 256_2!",
+                "1d436f9f3290e6d0076656cb5a06b024445a2c099134ca4f10d98615a65c0aa4");
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    r=test_lot();
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    r=test_multi("68f4ae1b62792228457af7e8952f63a327cebb7aff6cfe596ee716e5477f7807",
+                 "5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699",
+                 "Hello RSA 256_2!");
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    r=test_multi("89285e3254d3c85e712db22cd324994c702a50360d8de3a7",
+                 "16dc0fb30e234c0fbd879db1ddc4dba8d6659dbc8bf68443",
+                 "Hello RSA 192_1!");
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    r=test_simultane("68f4ae1b62792228457af7e8952f63a327cebb7aff6cfe596ee716e5477f7807",
+                     "5eb311ef411c04985825da55535a3725cf852564f7c42dc23a103aa5b85699",
+                     "Hello RSA 256_2!");
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    // modulo de 264 bits : nombre impair de chiffres quel que soit LIMB_BITS
+    r=test_simultane("d22aa6d40b849269c03170f5858bc976e44adc9ba6ac48eb86c610d98e9f34360b",
+                     "dfd048abd1bd7ce5ebe9855c03712b4dc1d10de7b9668789e3ec3e3a38775d6e",
+                     "Hello RSA 264_i!");
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    r=test_masque();
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    r=test_stock();
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    r=test_fichier();
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    r=test_inverse();
+    printf("%s\n\n",r==0?"OK":"!!");
+
+    r=test_genere();
     printf("%s\n\n",r==0?"OK":"!!");
 
+#ifdef RSA_COMPTEURS
+    CompteursAffiche();
+#endif
     return 0;
 }
 uint8_t ee_sn EEMEM;